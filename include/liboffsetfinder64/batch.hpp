@@ -0,0 +1,98 @@
+//
+//  batch.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef batch_hpp
+#define batch_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+        
+        /*
+         named finders, each returns its result as a JSON value.
+         Addresses are hex strings since JSON numbers can't hold 64bit pointers.
+         Addresses and patches are reported under the slide of the view the finder runs on.
+         */
+        class slideview;
+        class kextstore;
+        struct finder{
+            const char *name;
+            std::function<std::string(const slideview &view)> func;
+        };
+        const std::vector<finder> &finderRegistry();
+        const finder *finderNamed(const std::string &name); //NULL if unknown
+        
+        //runs f, on failure returns false and puts the error message into result
+        bool runFinder(const finder *f, offsetfinder64 &fi, std::string &result);
+        bool runFinder(const finder *f, const slideview &view, std::string &result);
+        
+        std::string jsonString(const std::string &str);
+        std::string jsonLoc(loc_t loc);
+        
+        class threadpool{
+            std::vector<std::thread> _workers;
+            std::deque<std::function<void()>> _tasks;
+            std::mutex _lock;
+            std::condition_variable _cond;
+            bool _stop;
+            
+            void worker();
+        public:
+            threadpool(unsigned threads);
+            void push(std::function<void()> task);
+            unsigned size() const {return (unsigned)_workers.size();};
+            ~threadpool();
+        };
+        
+        /*
+         runs a set of finders over many kernels on one shared thread pool.
+         Kernels are admitted while the combined file size of all loaded kernels stays below
+         sizeBudget (one kernel is always admitted). This is a file size budget, not a measured
+         RSS limit: decompression and the lazily built indexes come on top.
+         Every kernel is one load task followed by one task per finder, and produces one JSON line
+         on out once all its finders are done.
+         Finders of the same kernel run in parallel on one shared offsetfinder64.
+         */
+        class batchdriver{
+            threadpool _pool;
+            size_t _sizeBudget;
+            size_t _sizeInUse;
+            std::mutex _lock;
+            std::condition_variable _cond;
+            FILE *_out;
+            std::mutex _outLock;
+            std::function<void(offsetfinder64 &fi)> _prepare;
+            std::shared_ptr<kextstore> _store;
+        public:
+            batchdriver(unsigned threads, size_t sizeBudget = 0, FILE *out = stdout);
+            
+            //runs on every loaded kernel before its finders, failures count as load errors
+            void setPrepare(std::function<void(offsetfinder64 &fi)> prepare){_prepare = prepare;};
+            
+            //reuse stored results of unchanged kexts instead of running their finders, store the rest
+            void setStore(std::shared_ptr<kextstore> store){_store = store;};
+            
+            //returns the number of kernels which failed to load
+            size_t run(const std::vector<std::string> &kernels, const std::vector<const finder*> &finders, uint64_t slide = 0);
+        };
+        
+    };
+};
+
+#endif /* batch_hpp */
@@ -0,0 +1,62 @@
+//
+//  callgraph.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef callgraph_hpp
+#define callgraph_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <vector>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+
+        /*
+         every bl in the exec segments, built in one pass.
+         Function starts are the distinct call targets, a call belongs to the closest
+         function start at or below it. Calls are kept twice in CSR form:
+            by caller: sorted by call site, so the calls of a function are one contiguous run
+            by callee: sorted by callee, then call site
+         Calls to jump stubs are resolved to the stubs destination through the jumpstubs table.
+         */
+        class callgraph{
+        public:
+            struct call{
+                loc_t site;
+                loc_t target;   //bl destination
+                loc_t callee;   //target with jump stubs resolved
+            };
+            typedef std::pair<const call*, const call*> range;
+        private:
+            std::vector<loc_t> _functions;      //sorted
+            std::vector<call> _calls;           //by site
+            std::vector<uint32_t> _calleesOf;   //function index -> first call in _calls
+            std::vector<call> _callers;         //by callee, site
+            std::vector<uint32_t> _callersOf;   //function index -> first call in _callers
+
+            void build(offsetfinder64 &of);
+        public:
+            callgraph(offsetfinder64 &of);
+
+            const std::vector<loc_t> &functions() const {return _functions;};
+            loc_t functionFor(loc_t pc) const; //closest function start at or below pc, 0 if none
+
+            range callsIn(loc_t pc) const;      //calls made by the function containing pc
+            range callersOf(loc_t callee) const; //all calls to callee
+
+            const call *nthCallAfter(loc_t pc, size_t n) const; //n-th (from 1) call after pc, NULL if there is none
+            const call *firstCallTo(loc_t callee, loc_t after) const; //NULL if there is none
+            const call *lastCallTo(loc_t callee, loc_t before) const; //NULL if there is none
+
+            size_t size() const {return _calls.size();};
+        };
+
+    };
+};
+
+#endif /* callgraph_hpp */
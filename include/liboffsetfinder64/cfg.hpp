@@ -0,0 +1,86 @@
+//
+//  cfg.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef cfg_hpp
+#define cfg_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <vector>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+
+        /*
+         control flow graph of a single function.
+         Blocks are sorted by address, edges live in two flat arrays (successors/predecessors)
+         which blocks index into. Dominators and dominating conditions are computed on build,
+         so all queries are lookups afterwards.
+         */
+        class cfg{
+        public:
+            enum branchkind{
+                kNoBranch,
+                kBranchCond,
+                kBranchUncond,
+                kBranchCall,
+                kBranchIndirect,    //br, ret
+                kBranchIndirectCall //blr
+            };
+            struct edge{
+                uint32_t block;     //other end of the edge
+                loc_t branch;       //pc of the branch instruction, 0 for fallthrough
+            };
+            struct block{
+                loc_t start;
+                loc_t end;          //exclusive
+                uint32_t succOff;
+                uint32_t succCnt;
+                uint32_t predOff;
+                uint32_t predCnt;
+                int32_t idom;       //-1 for entry and unreachable blocks
+                int32_t domcond;    //block ending in the conditional branch that guards this block, -1 if none
+                bool domcondTaken;  //this block is on the taken side of domcond
+            };
+        private:
+            loc_t _start;
+            loc_t _end;
+            std::vector<block> _blocks;
+            std::vector<edge> _succs;
+            std::vector<edge> _preds;
+
+            void build(const uint32_t *words);
+            void buildDominators();
+
+        public:
+            cfg(offsetfinder64 &of, loc_t start, loc_t end);
+
+            static enum branchkind branchInfo(uint32_t i, uint64_t pc, uint64_t &target);
+
+            loc_t start() const {return _start;};
+            loc_t end() const {return _end;};
+            const std::vector<block> &blocks() const {return _blocks;};
+
+            size_t blockIndex(loc_t pc) const;
+            const block &blockAt(loc_t pc) const {return _blocks[blockIndex(pc)];};
+
+            std::pair<const edge*, const edge*> successors(size_t bi) const;
+            std::pair<const edge*, const edge*> predecessors(size_t bi) const;
+
+            //pcs of all branches in this function targeting the block containing pc
+            std::vector<loc_t> branchesTo(loc_t pc) const;
+
+            //pc of the conditional branch which decides whether pc is reached, 0 if none
+            loc_t dominatingCondition(loc_t pc, bool *taken = NULL) const;
+            bool dominates(size_t a, size_t b) const;
+        };
+
+    };
+};
+
+#endif /* cfg_hpp */
@@ -0,0 +1,66 @@
+//
+//  classify.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef classify_hpp
+#define classify_hpp
+
+#include <liboffsetfinder64/common.h>
+
+namespace tihmstar {
+    namespace patchfinder64{
+
+        /*
+         bulk instruction classification.
+         A block of up to 64 words is tested against a list of mask/value pairs at once
+         (AVX2/SSE2/NEON where available, scalar otherwise), producing one hit bitmask per pair:
+         bit k of out[c] is set if (words[k] & defs[c].mask) == defs[c].value.
+         */
+        enum insnclass{
+            kInsnClassAdrp = 0,
+            kInsnClassAdr,
+            kInsnClassAddSubImm,    //same as insn::is_add, includes sub
+            kInsnClassBl,
+            kInsnClassB,
+            kInsnClassBcond,
+            kInsnClassCbz,
+            kInsnClassCbnz,
+            kInsnClassTbz,
+            kInsnClassTbnz,
+            kInsnClassLdrImm,       //ldr w/x, unsigned offset
+            kInsnClassStrImm,       //str w/x, unsigned offset
+            kInsnClassStp,
+            kInsnClassMovz,
+            kInsnClassRet,
+            kInsnClassBr,
+
+            kInsnClassCount
+        };
+
+        struct insnclassdef{
+            uint32_t mask;
+            uint32_t value;
+        };
+
+        extern const insnclassdef insnclassdefs[kInsnClassCount];
+
+        static const size_t kClassifyBlockWords = 64;
+
+        //n is at most kClassifyBlockWords, out needs ndefs entries
+        void classifyBlock(const uint32_t *words, size_t n, const insnclassdef *defs, size_t ndefs, uint64_t *out);
+
+        //classifies against all insnclassdefs, out[kInsnClassCount]
+        inline void classifyBlock(const uint32_t *words, size_t n, uint64_t *out){
+            classifyBlock(words, n, insnclassdefs, kInsnClassCount, out);
+        }
+
+        const char *classifyImplementation(); //"avx2", "sse2", "neon" or "scalar"
+
+    };
+};
+
+#endif /* classify_hpp */
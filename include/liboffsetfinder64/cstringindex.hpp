@@ -0,0 +1,62 @@
+//
+//  cstringindex.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef cstringindex_hpp
+#define cstringindex_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <vector>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+
+        /*
+         every string in the __cstring and __os_log sections of the kernel and all kexts.
+         Built in one pass (NULs are found with memchr, which is vectorized in libc),
+         stored as a flat array sorted by string hash, so an exact lookup is a binary search
+         plus a compare and returns all copies of the string.
+         */
+        class cstringindex{
+            struct entry{
+                uint64_t hash;
+                loc_t loc;
+                const char *str;
+                size_t len;
+            };
+            struct section{
+                loc_t base;
+                const uint8_t *map;
+                size_t size;
+            };
+            std::vector<entry> _entries;    //sorted by hash, loc
+            std::vector<section> _sections;
+
+            void addSection(offsetfinder64 &of, loc_t base, size_t size);
+        public:
+            cstringindex(offsetfinder64 &of);
+
+            static uint64_t hash(const char *str, size_t len);
+
+            //exact matches only, str doesn't need to be NUL terminated
+            std::vector<loc_t> findAll(const char *str, size_t len) const; //sorted
+            loc_t find(const char *str, size_t len) const; //lowest address, 0 if none
+
+            //string starting at loc if loc is in a string section, NULL otherwise
+            const char *stringAt(loc_t loc, size_t *len = NULL) const;
+
+            //memmem over the string sections only, 0 if not found
+            loc_t search(const void *little, size_t little_len) const;
+
+            size_t size() const {return _entries.size();};
+        };
+
+    };
+};
+
+#endif /* cstringindex_hpp */
@@ -0,0 +1,67 @@
+//
+//  fixups.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef fixups_hpp
+#define fixups_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+        
+        /*
+         rebase chains of arm64e kernels, from LC_DYLD_CHAINED_FIXUPS or __TEXT,__thread_starts.
+         Only the chain heads are parsed up front. The first access to a segment walks all chains
+         in it once and keeps a rebased copy of the segment, after that derefs are plain loads.
+         */
+        class chainedfixups{
+        public:
+            enum pointerformat : uint16_t{
+                kPtrArm64e          = 1,
+                kPtr64              = 2,
+                kPtr64Offset        = 6,
+                kPtrArm64eKernel    = 7,
+                kPtr64KernelCache   = 8,
+                kPtrThreadStarts4   = 0x100,    //not dyld formats, pre chained fixups kernels
+                kPtrThreadStarts8   = 0x101
+            };
+        private:
+            struct chain{
+                loc_t start;
+                uint16_t format;
+            };
+            offsetfinder64 &_of;
+            loc_t _base;
+            std::vector<chain> _chains;                 //sorted by start
+            std::vector<std::vector<uint8_t>> _shadows; //per segment index, empty until built
+            std::unique_ptr<std::once_flag[]> _shadowOnce;
+            
+            void parseChainedFixups(const uint8_t *data, size_t size);
+            void parseThreadStarts(const uint8_t *data, size_t size);
+            void buildShadow(size_t segidx);
+        public:
+            chainedfixups(offsetfinder64 &of);
+            
+            bool empty() const {return _chains.empty();};
+            size_t chainCount() const {return _chains.size();};
+            
+            //decodes a single chain entry, nextDelta receives the byte distance to the next entry (0 = end of chain)
+            static uint64_t decode(uint64_t raw, uint16_t format, loc_t base, uint32_t *nextDelta);
+            
+            //segment memory with all rebases applied, NULL if pos isn't mapped
+            const void *rebasedMemoryForLoc(loc_t pos, size_t size);
+        };
+        
+    };
+};
+
+#endif /* fixups_hpp */
@@ -14,6 +14,8 @@
 
 namespace tihmstar{
     namespace patchfinder64{
+        class insnindex;
+        
         class insn{
         public:
             enum segtype{
@@ -65,6 +67,7 @@ namespace tihmstar{
             static bool is_bcond(uint32_t i);
             static bool is_b(uint32_t i);
             static bool is_nop(uint32_t i);
+            static uint64_t decode_logical_imm(uint32_t i); //for ORR/AND (immediate)
             
         public: //type
             enum type{
@@ -131,6 +134,9 @@ namespace tihmstar{
             operator void*();
             operator loc_t();
             operator enum type();
+        public: //seeking, exec segments only
+            insn &nextOf(enum type t, const insnindex &index); //like while (++i != t); throws out_of_range if there is none
+            insn &prevOf(enum type t, const insnindex &index); //like while (--i != t); throws out_of_range if there is none
         };
         
         loc_t find_literal_ref(segment_t segemts, loc_t pos, int ignoreTimes = 0);
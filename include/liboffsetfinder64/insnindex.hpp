@@ -0,0 +1,57 @@
+//
+//  insnindex.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef insnindex_hpp
+#define insnindex_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <liboffsetfinder64/insn.hpp>
+#include <vector>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+
+        /*
+         one position bitmap per insn::type over all exec segments.
+         Built in a single pass with the bulk classifier, bit k of a segment is set if
+         insn::type() of its k-th word is that type. Proximity queries ("next bl after pc")
+         then scan 64 instructions per step with ctz/clz instead of decoding every word.
+         Segments are padded to whole 64 word blocks, so a block never spans two segments.
+         */
+        class insnindex{
+        public:
+            static const size_t kTypeCount = insn::and_ + 1;
+        private:
+            struct range{
+                loc_t base;
+                size_t words;
+                size_t block;   //first block of this segment in the bitmaps
+            };
+            std::vector<range> _ranges; //exec segments sorted by base
+            std::vector<uint64_t> _bits[kTypeCount];
+
+            void build(const segment_t &segments);
+            const range *rangeFor(loc_t pc, bool after) const;
+        public:
+            insnindex(offsetfinder64 &of);
+            insnindex(const segment_t &segments);
+
+            //first instruction of type t after pc (exclusive), 0 if there is none
+            loc_t nextOf(enum insn::type t, loc_t pc) const;
+            //last instruction of type t before pc (exclusive), 0 if there is none
+            loc_t prevOf(enum insn::type t, loc_t pc) const;
+
+            size_t count(enum insn::type t) const; //number of instructions of type t
+            size_t memorySize() const;             //bytes used by the bitmaps
+        };
+
+    };
+};
+
+#endif /* insnindex_hpp */
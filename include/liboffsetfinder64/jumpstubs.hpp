@@ -0,0 +1,54 @@
+//
+//  jumpstubs.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef jumpstubs_hpp
+#define jumpstubs_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <unordered_map>
+#include <vector>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+
+        /*
+         every jump stub in one pass, plain (adrp xN ; ldr xN, [xN, #off] ; br xN) and
+         arm64e (adrp x17 ; add x17, x17, #off ; ldraa x16, [x17] ; braa x16, x17).
+         Stubs are collected from the __stubs and __auth_stubs sections of the kernel and of all kexts
+         (fileset entries and prelinked kexts). If there are no such sections, all exec
+         segments are scanned instead.
+         */
+        class jumpstubs{
+        public:
+            struct stub{
+                loc_t loc;
+                loc_t slot;     //pointer the stub branches through
+                loc_t target;   //resolved slot value, 0 if it couldn't be read
+            };
+        private:
+            std::unordered_map<loc_t,stub> _stubs;
+            std::unordered_multimap<loc_t,loc_t> _byTarget;
+            bool _fromSections;
+
+            void scan(offsetfinder64 &of, loc_t start, size_t size);
+            loc_t resolve(offsetfinder64 &of, loc_t slot);
+        public:
+            jumpstubs(offsetfinder64 &of);
+
+            const stub *find(loc_t loc) const; //NULL if loc is not a jump stub
+            std::vector<loc_t> stubsTo(loc_t target) const; //all stubs resolving to target, sorted
+
+            bool fromSections() const {return _fromSections;}; //false if exec segments were scanned
+            size_t size() const {return _stubs.size();};
+        };
+
+    };
+};
+
+#endif /* jumpstubs_hpp */
@@ -0,0 +1,57 @@
+//
+//  kextstore.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef kextstore_hpp
+#define kextstore_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+
+        /*
+         one independently linked part of a kernelcache: a fileset entry, a prelinked kext
+         or the kernel itself in a prelinked kernelcache. __LINKEDIT is not part of it.
+         */
+        struct kextimage{
+            std::string name;   //fileset entry id, empty for prelinked kexts (except the kernel)
+            std::string key;    //LC_UUID, content hash of the segments if there is none
+            std::vector<std::pair<loc_t,size_t>> segments;  //in load command order
+
+            bool contains(loc_t loc) const;
+        };
+
+        /*
+         content addressed store of finder results per kext, one file per kext key in a directory.
+         A result belongs to a kext if all of its addresses (and pointers in its patches) are inside
+         that kext. When a kext with the same key shows up in another kernelcache, its results are
+         relocated segment by segment to where the kext is linked now and reused.
+         */
+        class kextstore{
+            std::string _dir;
+
+            std::string pathFor(const kextimage &kext) const;
+        public:
+            kextstore(const std::string &dir);
+
+            //results of all stored kexts present in of, relocated and with slide added.
+            //finders with conflicting results from different kexts are left out
+            std::map<std::string,std::string> reuse(offsetfinder64 &of, uint64_t slide) const;
+
+            //adds results (slid by slide) to the records of the kexts they belong to
+            void store(offsetfinder64 &of, const std::map<std::string,std::string> &results, uint64_t slide) const;
+        };
+
+    };
+};
+
+#endif /* kextstore_hpp */
@@ -0,0 +1,49 @@
+//
+//  lazytable.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef lazytable_hpp
+#define lazytable_hpp
+
+#include <atomic>
+#include <mutex>
+
+namespace tihmstar {
+    namespace patchfinder64{
+
+        /*
+         table built on first use and never modified afterwards.
+         Once built, get() is a single acquire load. Only building takes the lock,
+         if the constructor throws nothing is published and the next get() retries.
+         */
+        template <typename T>
+        class lazytable{
+            std::mutex _buildLock;
+            std::atomic<T*> _table;
+        public:
+            lazytable() : _table(NULL) {};
+            lazytable(const lazytable &) = delete;
+            ~lazytable(){delete _table.load(std::memory_order_acquire);};
+
+            template <typename Arg>
+            T &get(Arg &arg){
+                if (T *table = _table.load(std::memory_order_acquire))
+                    return *table;
+                std::unique_lock<std::mutex> l(_buildLock);
+                T *table = _table.load(std::memory_order_relaxed);
+                if (!table) {
+                    table = new T(arg);
+                    _table.store(table, std::memory_order_release);
+                }
+                return *table;
+            }
+        };
+
+    };
+};
+
+#endif /* lazytable_hpp */
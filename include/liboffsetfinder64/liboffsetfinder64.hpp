@@ -15,13 +15,34 @@
 #include <mach-o/nlist.h>
 #include <mach-o/dyld_images.h>
 #include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
 #include <functional>
+#include <mutex>
 
 #include <stdlib.h>
 #include <liboffsetfinder64/common.h>
 #include <liboffsetfinder64/insn.hpp>
 #include <liboffsetfinder64/OFexception.hpp>
 #include <liboffsetfinder64/patch.hpp>
+#include <liboffsetfinder64/regtracker.hpp>
+#include <liboffsetfinder64/cfg.hpp>
+#include <liboffsetfinder64/lazytable.hpp>
+#include <liboffsetfinder64/vtable.hpp>
+#include <liboffsetfinder64/mig.hpp>
+#include <liboffsetfinder64/syscalls.hpp>
+#include <liboffsetfinder64/ofvariables.hpp>
+#include <liboffsetfinder64/pointerindex.hpp>
+#include <liboffsetfinder64/fixups.hpp>
+#include <liboffsetfinder64/pattern.hpp>
+#include <liboffsetfinder64/insnindex.hpp>
+#include <liboffsetfinder64/callgraph.hpp>
+#include <liboffsetfinder64/jumpstubs.hpp>
+#include <liboffsetfinder64/cstringindex.hpp>
+#include <liboffsetfinder64/porting.hpp>
+#include <liboffsetfinder64/symbolmap.hpp>
+#include <liboffsetfinder64/kextstore.hpp>
 
 namespace tihmstar {
     class offsetfinder64 {
@@ -33,6 +54,8 @@ namespace tihmstar {
         };
     private:
         bool _freeKernel;
+        uint8_t *_kmap;     //read only file mapping, NULL if the image lives in memory
+        size_t _kmapSize;
         bool _kernelIsSlid;
         uint64_t _kslide;
         uint8_t *_kdata;
@@ -42,26 +65,91 @@ namespace tihmstar {
         std::vector<patchfinder64::text_t> _segments;
         tristate _haveSymtab = kuninitialized;
         
+        patchfinder64::loc_t _vmBase;
+        patchfinder64::loc_t _vmEnd;
+        std::vector<uint16_t> _segmentPageTable; //page -> segment index+1 (0 means unmapped)
+        std::shared_ptr<patchfinder64::chainedfixups> _fixups; //NULL if the kernel has no rebase chains
+        
+        //symtab state is built once under its once_flag and is read only afterwards
+        std::once_flag _haveSymtabOnce;
+        std::once_flag _symtabOnce;
+        std::once_flag _symbolsByAddrOnce;
+        std::once_flag _kextsOnce;
+        std::unordered_map<uint64_t,const char *> _symbolsByAddr;
+        //built on first use, reads of built tables don't lock
+        patchfinder64::lazytable<patchfinder64::vtablecache> _vtables;
+        patchfinder64::lazytable<patchfinder64::migtable> _mig;
+        patchfinder64::lazytable<patchfinder64::syscalltable> _syscalls;
+        patchfinder64::lazytable<patchfinder64::ofvariabletable> _ofvariables;
+        patchfinder64::lazytable<patchfinder64::pointerindex> _pointers;
+        patchfinder64::lazytable<patchfinder64::insnindex> _insnIndex;
+        patchfinder64::lazytable<patchfinder64::callgraph> _callGraph;
+        patchfinder64::lazytable<patchfinder64::jumpstubs> _jumpStubs;
+        patchfinder64::lazytable<patchfinder64::cstringindex> _cstrings;
+        patchfinder64::lazytable<patchfinder64::fingerprints> _functionPrints;
+        std::shared_ptr<const patchfinder64::symbolmap> _symbols; //synthesized, only used without a symtab
+        std::vector<patchfinder64::kextimage> _kexts;
+        
+        std::mutex _functionCacheLock; //only held for lookups and inserts, never while building
+        std::map<patchfinder64::loc_t,std::shared_ptr<patchfinder64::cfg>> _cfgs; //by function start
+        std::map<patchfinder64::loc_t,std::shared_ptr<patchfinder64::regtracker>> _regtrackers; //by function start
+        
         struct symtab_command *__symtab;
         void loadSegments();
+        void buildSegmentPageTable();
+        void adviseSegments();
         __attribute__((always_inline)) struct symtab_command *getSymtab();
         
     public:
         offsetfinder64(const char *filename, uint64_t kslide = 0, tristate haveSymbols = kuninitialized);
         offsetfinder64(void* buf, size_t size, uint64_t kslide, tristate haveSymbols = kfalse);
         const void *kdata();
+        size_t ksize(){return _ksize;};
         patchfinder64::loc_t find_entry();
         patchfinder64::loc_t find_base();
         const std::vector<patchfinder64::text_t> &segments(){return _segments;};
-        bool haveSymbols();
+        patchfinder64::loc_t vmBase(){return _vmBase;};
+        patchfinder64::loc_t vmEnd(){return _vmEnd;};
+        bool isMapped(){return _kmap != NULL;};
+        void adviseSegment(const patchfinder64::text_t &seg, int advice); //madvise on the file mapping, no-op for images in memory
+        void releaseSegments(); //drops mapped segment pages from resident memory, they are paged back in on access
+        bool haveSymbols(); //symtab or synthesized symbols
+        bool haveSymtab(); //symtab only
+        void useSymbols(std::shared_ptr<const patchfinder64::symbolmap> symbols); //call before running finders
+        std::string uuid(); //LC_UUID as string, empty if there is none
+        std::vector<std::pair<patchfinder64::loc_t,size_t>> sections(const char *sectname); //of the kernel and all kexts
+        const std::vector<patchfinder64::kextimage> &kexts(); //fileset entries, or the kernel and all prelinked kexts
+        
+        const patchfinder64::text_t *segmentForLoc(patchfinder64::loc_t pos);
+        patchfinder64::offset_t     fileOffsetForLoc(patchfinder64::loc_t pos);
+        const void                 *memoryForLoc(patchfinder64::loc_t pos, size_t size = 1); //NULL if not mapped
+        const void                 *rebasedMemoryForLoc(patchfinder64::loc_t pos, size_t size = 1); //like memoryForLoc, with chained fixups applied
         
         patchfinder64::loc_t memmem(const void *little, size_t little_len);
+        patchfinder64::loc_t findString(const char *str, size_t len, bool hasNullTerminator); //exact string lookup, falls back to memmem
         uint64_t             deref(patchfinder64::loc_t pos);
         
         patchfinder64::loc_t find_sym(const char *sym);
+        patchfinder64::loc_t lookup_sym(const char *sym); //like find_sym, but 0 if there are no symbols or sym isn't one of them
+        const char          *find_sym_name(patchfinder64::loc_t addr); //NULL if there is no symbol at addr
+        std::vector<std::pair<const char *,patchfinder64::loc_t>> find_syms_with_prefix(const char *prefix);
         patchfinder64::loc_t find_syscall0();
         uint64_t             find_register_value(patchfinder64::loc_t where, int reg, patchfinder64::loc_t startAddr = 0);
         
+        std::pair<patchfinder64::loc_t,patchfinder64::loc_t> functionBounds(patchfinder64::loc_t where);
+        patchfinder64::cfg &functionCfg(patchfinder64::loc_t where); //cached per function
+        patchfinder64::regtracker &functionRegtracker(patchfinder64::loc_t where); //cached per function
+        patchfinder64::vtablecache &vtables();
+        patchfinder64::migtable &mig();
+        patchfinder64::syscalltable &syscalls();
+        patchfinder64::ofvariabletable &ofvariables();
+        patchfinder64::pointerindex &pointers();
+        patchfinder64::insnindex &insnIndex();
+        patchfinder64::callgraph &callGraph();
+        patchfinder64::jumpstubs &jumpStubs();
+        patchfinder64::cstringindex &cstrings();
+        patchfinder64::fingerprints &functionPrints();
+        
         /*------------------------ v0rtex -------------------------- */
         patchfinder64::loc_t find_zone_map();
         patchfinder64::loc_t find_kernel_map();
@@ -92,6 +180,7 @@ namespace tihmstar {
         patchfinder64::loc_t find_rop_add_x0_x0_0x10();
         patchfinder64::loc_t find_rop_ldr_x0_x0_0x10();
         patchfinder64::loc_t find_exec(std::function<bool(patchfinder64::insn &i)>cmpfunc);
+        patchfinder64::loc_t find_exec(const patchfinder64::pattern &p); //first match in any exec segment, 0 if none
         
         
         /*------------------------ kernelpatches -------------------------- */
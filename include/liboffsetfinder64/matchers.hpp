@@ -0,0 +1,128 @@
+//
+//  matchers.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef matchers_hpp
+#define matchers_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <vector>
+
+namespace tihmstar {
+    namespace patchfinder64{
+        /*
+         compile time instruction matchers.
+         Every matcher is a type with a constant mask/value, field constraints are folded into
+         those at compile time, so testing an instruction is a single and+cmp.
+         seq<...> chains matchers over consecutive instructions and inlines into one loop:
+            using gadget = matchers::seq<matchers::add_imm<0,0,0x40>, matchers::ret>;
+            loc_t loc = matchers::find<gadget>(segments);
+         */
+        namespace matchers{
+            static constexpr uint32_t any = 0xFFFFFFFF; //leaves a field unconstrained
+
+            template <uint32_t MASK, uint32_t VALUE>
+            struct op{
+                static_assert((VALUE & ~MASK) == 0, "value has bits outside of mask");
+                static constexpr uint32_t mask = MASK;
+                static constexpr uint32_t value = VALUE;
+                static inline bool test(uint32_t i){return (i & MASK) == VALUE;};
+            };
+
+            //constrains bits [SHIFT, SHIFT+BITS) of OP to V (or nothing if V is any)
+            template <typename OP, unsigned SHIFT, unsigned BITS, uint32_t V>
+            struct field : op<(V == any) ? OP::mask : (OP::mask | (((1u << BITS)-1) << SHIFT)),
+                              (V == any) ? OP::value : ((OP::value & ~(((1u << BITS)-1) << SHIFT)) | (V << SHIFT))>{
+                static_assert(V == any || V < (1u << BITS), "field value out of range");
+            };
+
+            template <typename OP, uint32_t R> using rd = field<OP, 0, 5, R>;
+            template <typename OP, uint32_t R> using rn = field<OP, 5, 5, R>;
+            template <typename OP, uint32_t R> using rm = field<OP, 16, 5, R>;
+            template <typename OP, uint32_t IMM> using imm12 = field<OP, 10, 12, IMM>;
+
+            //scaled unsigned offset of ldr/str, BYTES has to be a multiple of the access size
+            template <uint32_t BYTES, unsigned SCALE>
+            struct scaled{
+                static_assert(BYTES == any || (BYTES & ((1u << SCALE)-1)) == 0, "offset not aligned to access size");
+                static constexpr uint32_t value = (BYTES == any) ? any : (BYTES >> SCALE);
+            };
+
+            using add_x     = op<0xFFC00000, 0x91000000>;
+            using sub_x     = op<0xFFC00000, 0xD1000000>;
+            using ldr_x     = op<0xFFC00000, 0xF9400000>;
+            using str_x     = op<0xFFC00000, 0xF9000000>;
+            using ldr_w     = op<0xFFC00000, 0xB9400000>;
+            using str_w     = op<0xFFC00000, 0xB9000000>;
+            using adrp      = op<0x9F000000, 0x90000000>;
+            using adr       = op<0x9F000000, 0x10000000>;
+            using bl        = op<0xFC000000, 0x94000000>;
+            using b         = op<0xFC000000, 0x14000000>;
+            using cbz_x     = op<0xFF000000, 0xB4000000>;
+            using cbnz_x    = op<0xFF000000, 0xB5000000>;
+            using br        = op<0xFFFFFC1F, 0xD61F0000>;
+            using blr       = op<0xFFFFFC1F, 0xD63F0000>;
+            using ret       = op<0xFFFFFFFF, 0xD65F03C0>;
+            using nop       = op<0xFFFFFFFF, 0xD503201F>;
+            using anyinsn   = op<0, 0>;
+
+            template <uint32_t RD, uint32_t RN, uint32_t IMM> using add_imm = imm12<rn<rd<add_x, RD>, RN>, IMM>;
+            template <uint32_t RD, uint32_t RN, uint32_t IMM> using sub_imm = imm12<rn<rd<sub_x, RD>, RN>, IMM>;
+            template <uint32_t RT, uint32_t RN, uint32_t BYTES> using ldr_imm = imm12<rn<rd<ldr_x, RT>, RN>, scaled<BYTES,3>::value>;
+            template <uint32_t RT, uint32_t RN, uint32_t BYTES> using str_imm = imm12<rn<rd<str_x, RT>, RN>, scaled<BYTES,3>::value>;
+
+            template <typename ...OPS> struct seq;
+
+            template <>
+            struct seq<>{
+                static constexpr size_t size = 0;
+                static inline bool test(const uint32_t *){return true;};
+            };
+
+            template <typename FIRST, typename ...REST>
+            struct seq<FIRST, REST...>{
+                static constexpr size_t size = 1 + sizeof...(REST);
+                static inline bool test(const uint32_t *words){
+                    return FIRST::test(words[0]) && seq<REST...>::test(words+1);
+                };
+            };
+
+            //first match of SEQ in an exec segment, 0 if there is none
+            template <typename SEQ>
+            loc_t find(const std::vector<text_t> &segments){
+                for (auto &seg : segments) {
+                    if (!seg.isExec || seg.size < 4*SEQ::size)
+                        continue;
+                    const uint32_t *words = (const uint32_t *)seg.map;
+                    size_t n = seg.size/4 - SEQ::size + 1;
+                    for (size_t k=0; k<n; k++) {
+                        if (SEQ::test(words+k))
+                            return seg.base + 4*k;
+                    }
+                }
+                return 0;
+            }
+
+            //number of matches of SEQ in all exec segments
+            template <typename SEQ>
+            size_t count(const std::vector<text_t> &segments){
+                size_t ret = 0;
+                for (auto &seg : segments) {
+                    if (!seg.isExec || seg.size < 4*SEQ::size)
+                        continue;
+                    const uint32_t *words = (const uint32_t *)seg.map;
+                    size_t n = seg.size/4 - SEQ::size + 1;
+                    for (size_t k=0; k<n; k++)
+                        ret += SEQ::test(words+k);
+                }
+                return ret;
+            }
+        };
+    };
+};
+
+#endif /* matchers_hpp */
@@ -0,0 +1,58 @@
+//
+//  mig.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef mig_hpp
+#define mig_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <vector>
+#include <unordered_map>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+        
+        struct mig_routine{
+            uint32_t msgid;
+            loc_t impl_routine;
+            loc_t stub_routine;
+            uint32_t argc;
+            uint32_t max_reply_msg;
+        };
+        
+        struct mig_subsystem{
+            loc_t location;
+            loc_t server;
+            uint32_t start;
+            uint32_t end;
+            uint32_t maxsize;
+            std::vector<mig_routine> routines;
+        };
+        
+        /*
+         every mig_subsystem in the const data segments, discovered in one scan
+         and indexed by subsystem id and by message id.
+         */
+        class migtable{
+            std::vector<mig_subsystem> _subsystems;
+            std::unordered_map<uint32_t, size_t> _byStart;
+            std::unordered_map<uint32_t, std::pair<size_t, size_t>> _byMsgid;
+            
+            void scan(offsetfinder64 &of);
+        public:
+            migtable(offsetfinder64 &of);
+            
+            const std::vector<mig_subsystem> &subsystems() const {return _subsystems;};
+            const mig_subsystem &subsystem(uint32_t start) const;
+            const mig_routine &routine(uint32_t msgid) const;
+        };
+        
+    };
+};
+
+#endif /* mig_hpp */
@@ -0,0 +1,69 @@
+//
+//  ofvariables.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef ofvariables_hpp
+#define ofvariables_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <liboffsetfinder64/patch.hpp>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+        
+        enum OFVariableType : uint32_t{
+            kOFVariableTypeBoolean = 1,
+            kOFVariableTypeNumber,
+            kOFVariableTypeString,
+            kOFVariableTypeData
+        };
+        
+        enum OFVariablePerm : uint32_t{
+            kOFVariablePermRootOnly = 0,
+            kOFVariablePermUserRead,
+            kOFVariablePermUserWrite,
+            kOFVariablePermKernelOnly
+        };
+        
+        struct ofvariable{
+            std::string name;
+            OFVariableType type;
+            OFVariablePerm perm;
+            int32_t offset;
+            loc_t location;     //of the OFVariable entry in gOFVariables
+        };
+        
+        /*
+         IODTNVRAM's gOFVariables table, parsed once.
+         The table is found by symbol if possible, otherwise from a data reference
+         to one of the variable names and then walked to both ends.
+         */
+        class ofvariabletable{
+            loc_t _table;
+            std::vector<ofvariable> _vars;
+            std::unordered_map<std::string, size_t> _byName;
+            
+            loc_t findTableNoSym(offsetfinder64 &of);
+            void parse(offsetfinder64 &of);
+        public:
+            ofvariabletable(offsetfinder64 &of);
+            
+            loc_t location() const {return _table;};
+            const std::vector<ofvariable> &variables() const {return _vars;};
+            const ofvariable &variable(const char *name) const;
+            
+            patch permPatch(const char *name, OFVariablePerm perm) const;
+        };
+        
+    };
+};
+
+#endif /* ofvariables_hpp */
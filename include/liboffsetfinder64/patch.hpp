@@ -27,6 +27,7 @@ namespace tihmstar {
             patch(loc_t location, const void *patch, size_t patchSize, void(*slidefunc)(class patch *patch, uint64_t slide) = NULL);
             patch(const patch& cpy);
             void slide(uint64_t slide);
+            patch rebased(uint64_t slide) const; //copy moved by slide, content slid unless it already was
             ~patch();
         };
         
@@ -0,0 +1,71 @@
+//
+//  patchengine.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef patchengine_hpp
+#define patchengine_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <liboffsetfinder64/patch.hpp>
+#include <vector>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+        
+        class patchengine{
+        public:
+            enum patchstate{
+                kPatchUnknown = 0,
+                kPatchOriginal,
+                kPatchApplied
+            };
+        private:
+            struct entry{
+                offset_t fileoff;
+                size_t idx;
+            };
+            offsetfinder64 &_of;
+            std::vector<patch> _patches;
+            std::vector<entry> _sorted;
+            uint64_t _slide;
+            bool _validated;
+            
+            void validate();
+        public:
+            patchengine(offsetfinder64 &of, uint64_t slide = 0);
+            
+            void add(const patch &p);
+            void add(const std::vector<patch> &patches);
+            size_t size() const {return _patches.size();};
+            
+            /*
+             translates all patch locations to file offsets, applies slide once
+             and makes sure no two patches overlap or cross a segment boundary
+             */
+            void prepare();
+            
+            //buf needs to hold a copy of the (decompressed) kernel the offsetfinder was created with
+            void apply(void *buf, size_t bufSize);
+            
+            //writes the patched kernel in a single pass without copying the unpatched image
+            void write(const char *filename);
+            
+            /*
+             compares every patch against the bytes found in another image of the same kernel
+             (e.g. a dump of the running kernel). locationSlide is added to patch locations
+             when looking them up in the other image.
+             returned states are in the same order the patches were added
+             */
+            std::vector<patchstate> verify(offsetfinder64 &other, uint64_t locationSlide = 0);
+            static std::vector<patchstate> verify(const std::vector<patch> &patches, offsetfinder64 &original, offsetfinder64 &other, uint64_t slide = 0, uint64_t locationSlide = 0);
+        };
+        
+    };
+};
+
+#endif /* patchengine_hpp */
@@ -0,0 +1,104 @@
+//
+//  pattern.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef pattern_hpp
+#define pattern_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <liboffsetfinder64/classify.hpp>
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+
+        /*
+         instruction sequence patterns, e.g.
+            "add xD, xN, #0x40 ; ret"
+            "adrp xR, ? ; ldr xR, [xR, #?]"
+         Instructions are separated by ';', a lone '?' matches any instruction.
+         Registers are fixed (x0, w3, sp, xzr), wildcards (x?) or captures (xA..xZ),
+         immediates are fixed (#0x10), wildcards (#?) or captures (#A..#Z).
+         Captures with the same letter have to match the same value everywhere in the pattern.
+         Branch and adrp targets can only be '?'.
+         Loads and stores only take the unsigned offset form [xN, #imm], pre- and post-index are rejected.
+         */
+        struct patternmatch{
+            loc_t loc;
+            size_t pattern;         //index in the patternset
+            uint64_t values[26];    //captured values, by letter
+            uint32_t captured;      //bitmask of captured letters
+
+            uint64_t capture(char name) const; //throws if name wasn't captured
+        };
+
+        class pattern{
+        public:
+            struct field{
+                uint8_t shift;
+                uint8_t bits;
+                uint8_t scale;  //captured value is field << scale
+                uint8_t slot;   //capture letter
+            };
+            struct step{
+                uint32_t mask;
+                uint32_t value;
+                std::vector<field> captures;
+            };
+        private:
+            std::string _source;
+            std::vector<step> _steps;
+
+            void compileInsn(const std::string &src);
+        public:
+            pattern(const std::string &src);
+
+            const std::string &source() const {return _source;};
+            const std::vector<step> &steps() const {return _steps;};
+            size_t size() const {return _steps.size();};
+
+            //matches at words, which has at least avail instructions
+            bool match(const uint32_t *words, size_t avail, patternmatch &m) const;
+
+            //first match at or after start within the same segment, 0 if there is none
+            loc_t next(offsetfinder64 &of, loc_t start, patternmatch *m = NULL) const;
+        };
+
+        /*
+         many patterns matched in a single pass over all exec segments.
+         Patterns are bucketed by the top byte of their first instruction, so each word only
+         looks at the patterns which can start there. With few distinct first instructions,
+         blocks are prefiltered by the bulk classifier and only hits are looked at.
+         */
+        class patternset{
+            std::vector<pattern> _patterns;
+            std::vector<std::vector<uint32_t>> _buckets; //top byte of the first word -> pattern indices
+            std::vector<insnclassdef> _firstDefs;         //distinct first instructions
+            bool _prefilter;                             //false if a pattern starts with '?' or there are too many first instructions
+        public:
+            patternset();
+            
+            static const size_t kMaxPrefilterDefs = 8;
+
+            size_t add(const pattern &p); //returns the index matches report
+            size_t size() const {return _patterns.size();};
+            const pattern &at(size_t i) const {return _patterns.at(i);};
+
+            //calls cb for every match in address order, stops when cb returns false
+            void scan(offsetfinder64 &of, std::function<bool(const patternmatch &m)> cb) const;
+
+            //first match of every pattern (0 if none), stops scanning once all were found
+            std::vector<loc_t> first(offsetfinder64 &of) const;
+        };
+
+    };
+};
+
+#endif /* pattern_hpp */
@@ -0,0 +1,51 @@
+//
+//  pointerindex.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef pointerindex_hpp
+#define pointerindex_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <vector>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+        
+        /*
+         every aligned pointer in the data segments which points into the image.
+         Built in one pass, stored as a flat array sorted by target so lookups are
+         a binary search instead of a memmem over the whole kernel.
+         */
+        class pointerindex{
+        public:
+            struct xref{
+                loc_t target;
+                loc_t location;     //where the pointer is stored
+            };
+        private:
+            loc_t _base;
+            loc_t _vmBase;
+            loc_t _vmEnd;
+            std::vector<xref> _refs;
+            
+            void build(offsetfinder64 &of);
+        public:
+            pointerindex(offsetfinder64 &of);
+            
+            //strips tags and decodes chained fixup encodings, 0 if v isn't a pointer into the image
+            loc_t normalize(uint64_t v) const;
+            
+            std::pair<const xref*, const xref*> refsTo(loc_t target) const;
+            loc_t firstRefTo(loc_t target) const; //lowest location, 0 if none
+            size_t size() const {return _refs.size();};
+        };
+        
+    };
+};
+
+#endif /* pointerindex_hpp */
@@ -0,0 +1,108 @@
+//
+//  porting.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef porting_hpp
+#define porting_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+
+        /*
+         position independent fingerprints of every function (callgraph function starts).
+            code:    hash of the instruction words with relocated fields masked
+                     (branch/adrp/adr/literal targets, page offsets right after an adrp)
+            strings: hash of the C strings the function references through adrp+add
+            shape:   number of instructions, calls and branches
+         Two functions with the same code hash have the same layout, so offsets into them carry over.
+         */
+        class fingerprints{
+        public:
+            struct function{
+                loc_t start;
+                uint32_t insns;
+                uint32_t calls;
+                uint32_t branches;
+                uint64_t code;
+                uint64_t strings;   //0 if the function references no strings
+            };
+            static const uint32_t kMaxFunctionInsns = 0x4000;
+        private:
+            std::vector<function> _functions; //sorted by start
+        public:
+            fingerprints(){};
+            fingerprints(offsetfinder64 &of);
+
+            const std::vector<function> &functions() const {return _functions;};
+            const function *functionFor(loc_t pc) const; //NULL if pc isn't inside a function
+
+            void save(FILE *f) const;
+            bool loadLine(const char *line); //parses one line written by save, false if it isn't one
+        };
+
+        /*
+         matches the functions of two kernels.
+         A match is exact if code, strings and shape agree and that combination is unique
+         in both kernels. Functions which only agree on a unique string set are matched fuzzily,
+         they are reported but never used for porting.
+         */
+        class offsetporter{
+        public:
+            struct match{
+                const fingerprints::function *from;
+                const fingerprints::function *to;
+                bool exact;
+            };
+        private:
+            const fingerprints &_from;
+            const fingerprints &_to;
+            std::vector<match> _matches; //sorted by from->start
+            size_t _exact;
+
+            const match *matchFor(loc_t from) const;
+        public:
+            offsetporter(const fingerprints &from, const fingerprints &to);
+
+            const std::vector<match> &matches() const {return _matches;};
+            size_t exactMatches() const {return _exact;};
+
+            //location in the new kernel, 0 if loc isn't inside an exactly matched function
+            loc_t port(loc_t loc) const;
+
+            //ports a finder registry result (address, patch or list of patches), false if it can't be ported.
+            //ported addresses and pointers in patches get slide added
+            bool portResult(const std::string &json, uint64_t slide, std::string &ported) const;
+        };
+
+        //rewrites every address in a finder registry result (address, patch or list of patches) with relocate
+        //and adds slide, false if relocate returns 0 for one of them. Plain numbers can't be relocated
+        bool relocateResult(const std::string &json, const std::function<loc_t(loc_t)> &relocate, uint64_t slide, std::string &relocated);
+
+        /*
+         everything kept from analysing a kernel: fingerprints and unslid finder results by name.
+         Stored as text, one "F" line per function and one "R name result" line per finder.
+         */
+        struct analysis{
+            fingerprints prints;
+            std::map<std::string,std::string> results;
+
+            void save(const char *path) const;
+            void load(const char *path);
+        };
+
+    };
+};
+
+#endif /* porting_hpp */
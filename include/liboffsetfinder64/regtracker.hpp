@@ -0,0 +1,74 @@
+//
+//  regtracker.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef regtracker_hpp
+#define regtracker_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <liboffsetfinder64/insn.hpp>
+#include <vector>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+
+        /*
+         constant propagation over a single function.
+         The function is evaluated once in a forward pass over its cfg, remembering the register
+         state at the start of every basic block. Queries replay at most one block from that state.
+         */
+        class cfg;
+        
+        class regtracker{
+        public:
+            struct regstate{
+                uint64_t value[32];
+                uint64_t loadaddr[32];  //address the register was loaded from (if any)
+                uint32_t known;         //bitmask of registers with known value
+                uint32_t loaded;        //bitmask of registers with known loadaddr
+            };
+        private:
+            struct block{
+                loc_t start;
+                bool reachable;
+                uint32_t loopclobber;   //registers written inside loops which branch back here
+                regstate in;
+            };
+            offsetfinder64 &_of;
+            loc_t _start;
+            loc_t _end;
+            std::vector<block> _blocks;
+
+            void build(const cfg &g);
+            void step(uint32_t i, loc_t pc, regstate &s);
+            bool derefmem(uint64_t addr, int size, uint64_t &val);
+            size_t blockIndex(loc_t pc) const;
+
+        public:
+            regtracker(offsetfinder64 &of, const cfg &g);
+
+            loc_t start() const {return _start;};
+            loc_t end() const {return _end;};
+
+            //register state right before the instruction at pc is executed
+            regstate stateAt(loc_t pc);
+
+            bool value(loc_t pc, int reg, uint64_t *val);
+            bool loadAddress(loc_t pc, int reg, loc_t *addr);
+
+            //throws if the value is not known
+            uint64_t valueAt(loc_t pc, int reg);
+
+            //registers written by an instruction (approximation for unmodeled instructions)
+            static uint32_t writemask(uint32_t i);
+        };
+
+    };
+};
+
+#endif /* regtracker_hpp */
@@ -0,0 +1,88 @@
+//
+//  server.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef server_hpp
+#define server_hpp
+
+#include <liboffsetfinder64/batch.hpp>
+#include <string>
+#include <list>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <sys/types.h>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+        
+        /*
+         long running offset server on a unix domain socket.
+         Line based protocol, every request gets exactly one JSON line back:
+            find <kernelpath> <finder>[,<finder>...] [slide]
+            stats
+            shutdown
+         Loaded kernels stay warm in an LRU keyed by LC_UUID, so the same kernel under
+         different paths is only loaded once. Requests with different slides share the loaded kernel.
+         Each connection has its own thread and hands its requests to the pool, so idle connections
+         don't hold a worker.
+         */
+        class offsetserver{
+            struct kernelentry{
+                std::string key;
+                std::shared_ptr<offsetfinder64> fi;
+            };
+            struct pathentry{
+                std::string key;
+                time_t mtime;
+                off_t size;
+            };
+            
+            std::string _path;
+            int _listenfd;
+            size_t _cacheSize;
+            threadpool _pool;
+            std::atomic<bool> _stop;
+            
+            std::mutex _connLock;
+            std::condition_variable _connCond;
+            size_t _connections;
+            
+            std::mutex _cacheLock;
+            std::list<kernelentry> _lru; //most recently used first
+            std::unordered_map<std::string, std::list<kernelentry>::iterator> _byKey;
+            std::unordered_map<std::string, pathentry> _byPath;
+            
+            std::mutex _statsLock;
+            uint64_t _requests;
+            uint64_t _failed;
+            uint64_t _hits;
+            uint64_t _misses;
+            uint64_t _latencyTotalUs;
+            uint64_t _latencyMaxUs;
+            
+            kernelentry kernel(const std::string &path, bool &cached);
+            std::string handleRequest(const std::string &line);
+            void handleConnection(int fd);
+        public:
+            offsetserver(const std::string &socketPath, unsigned threads, size_t cacheSize = 4);
+            
+            //blocks until a shutdown request was received
+            void serve();
+            void stop();
+            
+            //client side, sends a single request line and returns the response line
+            static std::string request(const std::string &socketPath, const std::string &line);
+            
+            ~offsetserver();
+        };
+        
+    };
+};
+
+#endif /* server_hpp */
@@ -0,0 +1,50 @@
+//
+//  slideview.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef slideview_hpp
+#define slideview_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <liboffsetfinder64/patch.hpp>
+#include <vector>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+
+        /*
+         one loaded kernel seen under a different slide.
+         The view only holds a reference to the offsetfinder64 and the slide, so the buffer and
+         every index built so far are shared and a view for a new slide costs nothing.
+         The slide is added on top of the addresses the offsetfinder64 reports.
+         */
+        class slideview{
+            offsetfinder64 &_of;
+            uint64_t _slide;
+        public:
+            slideview(offsetfinder64 &of, uint64_t slide = 0) : _of(of), _slide(slide) {};
+
+            offsetfinder64 &finder() const {return _of;};
+            uint64_t slide() const {return _slide;};
+            slideview withSlide(uint64_t slide) const {return slideview(_of, slide);};
+
+            loc_t slid(loc_t loc) const {return loc + _slide;};
+            loc_t unslid(loc_t loc) const {return loc - _slide;};
+            patch slid(const patch &p) const {return p.rebased(_slide);};
+            std::vector<patch> slid(const std::vector<patch> &patches) const;
+
+            //run a finder on the shared offsetfinder64 and slide its result
+            loc_t find(loc_t (offsetfinder64::*f)()) const;
+            patch find(patch (offsetfinder64::*f)()) const;
+            std::vector<patch> find(std::vector<patch> (offsetfinder64::*f)()) const;
+        };
+
+    };
+};
+
+#endif /* slideview_hpp */
@@ -0,0 +1,58 @@
+//
+//  symbolmap.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef symbolmap_hpp
+#define symbolmap_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+
+        /*
+         symbols of a stripped kernel, transferred from a symbolized reference kernel.
+            functions: starts of exactly matched functions (see offsetporter)
+            callees:   bl targets inside exactly matched functions
+            data:      adrp+add/ldr/str targets inside exactly matched functions
+         A name which ends up at two different addresses is dropped.
+         */
+        class symbolmap{
+            std::string _uuid; //of the stripped kernel
+            std::unordered_map<std::string,loc_t> _byName;
+            std::unordered_map<loc_t,const char *> _byAddr; //points into the keys of _byName
+
+            void add(const std::string &name, loc_t loc, std::unordered_set<std::string> &conflicts);
+            void transferReferences(offsetfinder64 &reference, offsetfinder64 &stripped, loc_t from, loc_t to, uint32_t insns,
+                                    std::unordered_set<std::string> &conflicts);
+            void rebuildByAddr();
+        public:
+            symbolmap(){};
+            symbolmap(offsetfinder64 &reference, offsetfinder64 &stripped);
+            symbolmap(const symbolmap &) = delete; //_byAddr points into _byName
+
+            loc_t find(const char *name) const; //0 if unknown
+            const char *nameFor(loc_t loc) const; //NULL if there is no symbol at loc
+            std::vector<std::pair<const char *,loc_t>> withPrefix(const char *prefix) const;
+
+            const std::string &uuid() const {return _uuid;};
+            size_t size() const {return _byName.size();};
+
+            //text cache, one "U uuid" line followed by one "S address name" line per symbol
+            void save(const char *path) const;
+            void load(const char *path);
+        };
+
+    };
+};
+
+#endif /* symbolmap_hpp */
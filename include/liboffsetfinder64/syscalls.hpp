@@ -0,0 +1,66 @@
+//
+//  syscalls.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef syscalls_hpp
+#define syscalls_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+        
+        /*
+         decoded sysent and mach_trap_table.
+         Both tables are validated and parsed once, the record stride is detected
+         instead of assumed, so lookups by number are plain array accesses.
+         */
+        class syscalltable{
+        public:
+            struct entry{
+                uint32_t number;
+                loc_t handler;      //0 if the slot is not a valid handler
+                uint32_t argc;
+            };
+        private:
+            offsetfinder64 &_of;
+            loc_t _sysent;
+            uint32_t _sysentStride;
+            std::vector<entry> _syscalls;
+            
+            loc_t _machTraps;
+            uint32_t _machTrapStride;
+            std::vector<entry> _machtraps;
+            std::mutex _machTrapsLock; //only held while parsing
+            std::atomic<bool> _machTrapsParsed;
+            
+            void parseSysent();
+            void parseMachTraps();
+            void ensureMachTraps();
+        public:
+            syscalltable(offsetfinder64 &of);
+            
+            loc_t sysentLocation() const {return _sysent;};
+            uint32_t sysentStride() const {return _sysentStride;};
+            const std::vector<entry> &syscalls() const {return _syscalls;};
+            const entry &syscall(uint32_t num) const;
+            
+            //mach_trap_table is parsed on first use
+            loc_t machTrapLocation(); //start of trap 0 (mach_trap_arg_count)
+            uint32_t machTrapStride();
+            const std::vector<entry> &machTraps();
+            const entry &machTrap(uint32_t num);
+        };
+        
+    };
+};
+
+#endif /* syscalls_hpp */
@@ -0,0 +1,69 @@
+//
+//  vtable.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef vtable_hpp
+#define vtable_hpp
+
+#include <liboffsetfinder64/common.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+namespace tihmstar {
+    class offsetfinder64;
+    namespace patchfinder64{
+        
+        struct vtable{
+            struct entry{
+                uint32_t index;
+                loc_t target;
+                const char *symbol; //NULL on stripped kernels
+            };
+            std::string classname;  //empty if it couldn't be named on a stripped kernel
+            loc_t base;             //address of slot 0 (__ZTV + 0x10)
+            std::vector<entry> entries;
+        };
+        
+        /*
+         decodes all vtables of the kernel once on construction (by __ZTV symbols, or by
+         scanning const data on stripped kernels) together with a reverse map from method
+         implementation to all (vtable, slot) pairs. Never modified afterwards, so lookups
+         don't lock.
+         On stripped kernels a vtable is named through its getMetaClass() entry, which returns
+         the metaclass instance the OSMetaClass constructor was called with next to the class name string.
+         */
+        class vtablecache{
+            offsetfinder64 &_of;
+            std::unordered_map<std::string, std::shared_ptr<vtable>> _byClass;
+            std::unordered_map<uint64_t, std::shared_ptr<vtable>> _byBase;
+            std::unordered_map<uint64_t, std::vector<std::pair<const vtable*,uint32_t>>> _byImpl;
+            
+            std::shared_ptr<vtable> decode(loc_t base, const std::string &classname);
+            void indexSymbols();
+            void indexStripped();
+            void nameStripped();
+        public:
+            vtablecache(offsetfinder64 &of);
+            
+            static std::string vtableSymbol(const std::string &classname);
+            
+            const vtable &forClass(const std::string &classname) const;
+            const vtable &at(loc_t base) const; //base has to be the start of a known vtable
+            
+            //all vtable slots across all classes pointing to impl
+            const std::vector<std::pair<const vtable*,uint32_t>> &slotsOf(loc_t impl) const;
+            
+            //slot of impl in the vtable of classname, -1 if not present
+            int32_t slotOf(const std::string &classname, loc_t impl) const;
+        };
+        
+    };
+};
+
+#endif /* vtable_hpp */
@@ -0,0 +1,364 @@
+//
+//  batch.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "batch.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/batch.hpp>
+#include <liboffsetfinder64/slideview.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <sys/stat.h>
+#include <chrono>
+#include <memory>
+#include <atomic>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+#define KERNEL_SIZE_FALLBACK (64*1024*1024)
+
+#pragma mark json
+
+std::string patchfinder64::jsonString(const std::string &str){
+    std::string ret = "\"";
+    for (unsigned char c : str) {
+        switch (c) {
+            case '"':  ret += "\\\""; break;
+            case '\\': ret += "\\\\"; break;
+            case '\n': ret += "\\n"; break;
+            case '\t': ret += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    ret += buf;
+                }else{
+                    ret += (char)c;
+                }
+                break;
+        }
+    }
+    return ret + "\"";
+}
+
+std::string patchfinder64::jsonLoc(loc_t loc){
+    char buf[0x20];
+    snprintf(buf, sizeof(buf), "\"0x%llx\"", (unsigned long long)loc);
+    return buf;
+}
+
+static std::string jsonPatch(const patch &p){
+    std::string bytes;
+    for (size_t i=0; i<p._patchSize; i++) {
+        char buf[4];
+        snprintf(buf, sizeof(buf), "%02x", ((const uint8_t*)p._patch)[i]);
+        bytes += buf;
+    }
+    return "{\"location\":" + jsonLoc(p._location) + ",\"patch\":\"" + bytes + "\"}";
+}
+
+static std::string jsonPatches(const std::vector<patch> &patches){
+    std::string ret = "[";
+    for (auto &p : patches) {
+        if (ret.size() > 1) ret += ",";
+        ret += jsonPatch(p);
+    }
+    return ret + "]";
+}
+
+#pragma mark finder registry
+
+#define LOC_FINDER(f)     {#f, [](const slideview &v){return jsonLoc(v.find(&offsetfinder64::f));}}
+#define OFF_FINDER(f)     {#f, [](const slideview &v){return std::to_string(v.finder().f());}}
+#define PATCH_FINDER(f)   {#f, [](const slideview &v){return jsonPatch(v.find(&offsetfinder64::f));}}
+#define PATCHES_FINDER(f) {#f, [](const slideview &v){return jsonPatches(v.find(&offsetfinder64::f));}}
+
+const std::vector<finder> &patchfinder64::finderRegistry(){
+    static const std::vector<finder> finders = {
+        LOC_FINDER(find_entry),
+        LOC_FINDER(find_base),
+        LOC_FINDER(find_syscall0),
+        /*------------------------ v0rtex -------------------------- */
+        LOC_FINDER(find_zone_map),
+        LOC_FINDER(find_kernel_map),
+        LOC_FINDER(find_kernel_task),
+        LOC_FINDER(find_realhost),
+        LOC_FINDER(find_bzero),
+        LOC_FINDER(find_bcopy),
+        LOC_FINDER(find_copyout),
+        LOC_FINDER(find_copyin),
+        LOC_FINDER(find_ipc_port_alloc_special),
+        LOC_FINDER(find_ipc_kobject_set),
+        LOC_FINDER(find_ipc_port_make_send),
+        LOC_FINDER(find_chgproccnt),
+        LOC_FINDER(find_kauth_cred_ref),
+        LOC_FINDER(find_osserializer_serialize),
+        OFF_FINDER(find_vtab_get_external_trap_for_index),
+        OFF_FINDER(find_vtab_get_retain_count),
+        OFF_FINDER(find_iouserclient_ipc),
+        OFF_FINDER(find_ipc_space_is_task),
+        OFF_FINDER(find_ipc_space_is_task_11),
+        OFF_FINDER(find_proc_ucred),
+        OFF_FINDER(find_task_bsd_info),
+        OFF_FINDER(find_vm_map_hdr),
+        OFF_FINDER(find_task_itk_self),
+        OFF_FINDER(find_task_itk_registered),
+        OFF_FINDER(find_sizeof_task),
+        LOC_FINDER(find_rop_add_x0_x0_0x10),
+        LOC_FINDER(find_rop_ldr_x0_x0_0x10),
+        /*------------------------ kernelpatches -------------------------- */
+        PATCH_FINDER(find_i_can_has_debugger_patch_off),
+        PATCH_FINDER(find_lwvm_patch_offsets),
+        PATCH_FINDER(find_remount_patch_offset),
+        PATCHES_FINDER(find_nosuid_off),
+        PATCH_FINDER(find_proc_enforce),
+        PATCH_FINDER(find_amfi_patch_offsets),
+        PATCH_FINDER(find_cs_enforcement_disable_amfi),
+        PATCH_FINDER(find_amfi_substrate_patch),
+        PATCH_FINDER(find_sandbox_patch),
+        LOC_FINDER(find_sbops),
+        PATCH_FINDER(find_nonceEnabler_patch),
+        PATCH_FINDER(find_nonceEnabler_patch_nosym),
+        /*------------------------ KPP bypass -------------------------- */
+        LOC_FINDER(find_gPhysBase),
+        LOC_FINDER(find_gPhysBase_nosym),
+        LOC_FINDER(find_kernel_pmap),
+        LOC_FINDER(find_kernel_pmap_nosym),
+        LOC_FINDER(find_cpacr_write),
+        LOC_FINDER(find_idlesleep_str_loc),
+        LOC_FINDER(find_deepsleep_str_loc),
+        /*------------------------ Util -------------------------- */
+        LOC_FINDER(find_rootvnode),
+        LOC_FINDER(find_allproc),
+    };
+    return finders;
+}
+
+const finder *patchfinder64::finderNamed(const std::string &name){
+    for (auto &f : finderRegistry()) {
+        if (name == f.name)
+            return &f;
+    }
+    return NULL;
+}
+
+bool patchfinder64::runFinder(const finder *f, offsetfinder64 &fi, std::string &result){
+    return runFinder(f, slideview(fi), result);
+}
+
+bool patchfinder64::runFinder(const finder *f, const slideview &view, std::string &result){
+    try {
+        result = f->func(view);
+        return true;
+    } catch (tihmstar::exception &e) {
+        result = e.what();
+    } catch (std::exception &e) {
+        result = e.what();
+    } catch (...) {
+        result = "unknown error";
+    }
+    return false;
+}
+
+#pragma mark threadpool
+
+threadpool::threadpool(unsigned threads) :
+    _stop(false)
+{
+    if (!threads)
+        threads = 1;
+    for (unsigned i=0; i<threads; i++)
+        _workers.push_back(std::thread([this]{worker();}));
+}
+
+void threadpool::worker(){
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> l(_lock);
+            _cond.wait(l, [this]{return _stop || _tasks.size();});
+            if (_tasks.empty())
+                return; //stopping and drained
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void threadpool::push(std::function<void()> task){
+    {
+        std::unique_lock<std::mutex> l(_lock);
+        _tasks.push_back(std::move(task));
+    }
+    _cond.notify_one();
+}
+
+threadpool::~threadpool(){
+    {
+        std::unique_lock<std::mutex> l(_lock);
+        _stop = true;
+    }
+    _cond.notify_all();
+    for (auto &t : _workers)
+        t.join();
+}
+
+#pragma mark batchdriver
+
+namespace {
+    struct kerneljob{
+        std::string path;
+        size_t reserved;
+        std::chrono::steady_clock::time_point start;
+        double loadMs;
+        std::shared_ptr<offsetfinder64> fi;
+        std::atomic<size_t> pending; //finders run concurrently on the same instance
+        std::vector<std::string> results;
+        std::vector<std::string> errors;
+        std::map<std::string,std::string> reused; //from the kext store
+    };
+    
+    double msSince(std::chrono::steady_clock::time_point start){
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    
+    //what a kernel counts against the size budget, its file size
+    size_t kernelFileSize(const std::string &path){
+        struct stat st;
+        memset(&st, 0, sizeof(st));
+        if (stat(path.c_str(), &st) || st.st_size <= 0)
+            return KERNEL_SIZE_FALLBACK;
+        return (size_t)st.st_size;
+    }
+}
+
+batchdriver::batchdriver(unsigned threads, size_t sizeBudget, FILE *out) :
+    _pool(threads),
+    _sizeBudget(sizeBudget),
+    _sizeInUse(0),
+    _out(out)
+{
+    //
+}
+
+size_t batchdriver::run(const std::vector<std::string> &kernels, const std::vector<const finder*> &finders, uint64_t slide){
+    size_t remaining = kernels.size();
+    size_t failed = 0;
+    
+    auto finish = [&](std::shared_ptr<kerneljob> job, const std::string &loadError){
+        std::string line = "{\"kernel\":" + jsonString(job->path);
+        if (loadError.size()) {
+            line += ",\"error\":" + jsonString(loadError);
+        }else{
+            std::string results, errors;
+            for (size_t i=0; i<finders.size(); i++) {
+                if (job->errors[i].size()) {
+                    errors += (errors.size() ? "," : "") + jsonString(finders[i]->name) + ":" + jsonString(job->errors[i]);
+                }else{
+                    results += (results.size() ? "," : "") + jsonString(finders[i]->name) + ":" + job->results[i];
+                }
+            }
+            if (_store) {
+                std::map<std::string,std::string> computed;
+                for (size_t i=0; i<finders.size(); i++) {
+                    if (job->errors[i].empty() && !job->reused.count(finders[i]->name))
+                        computed[finders[i]->name] = job->results[i];
+                }
+                try {
+                    _store->store(*job->fi, computed, slide);
+                } catch (tihmstar::exception &e) {
+                    //the store is only a cache
+                }
+            }
+            char timing[0x80];
+            snprintf(timing, sizeof(timing), ",\"load_ms\":%.1f,\"total_ms\":%.1f,\"reused\":%zu", job->loadMs, msSince(job->start), job->reused.size());
+            line += timing;
+            line += ",\"results\":{" + results + "},\"errors\":{" + errors + "}";
+        }
+        line += "}\n";
+        {
+            std::unique_lock<std::mutex> l(_outLock);
+            fputs(line.c_str(), _out);
+            fflush(_out);
+        }
+        
+        job->fi = NULL;
+        
+        //notify with the lock held, run() may return as soon as remaining hits 0
+        std::unique_lock<std::mutex> l(_lock);
+        _sizeInUse -= job->reserved;
+        if (loadError.size())
+            failed++;
+        remaining--;
+        _cond.notify_all();
+    };
+    
+    for (auto &path : kernels) {
+        std::shared_ptr<kerneljob> job(new kerneljob);
+        job->path = path;
+        job->reserved = kernelFileSize(path);
+        job->loadMs = 0;
+        job->pending = finders.size();
+        job->results.resize(finders.size());
+        job->errors.resize(finders.size());
+        
+        {
+            std::unique_lock<std::mutex> l(_lock);
+            _cond.wait(l, [&]{
+                return !_sizeBudget || !_sizeInUse || _sizeInUse + job->reserved <= _sizeBudget;
+            });
+            _sizeInUse += job->reserved;
+        }
+        
+        job->start = std::chrono::steady_clock::now();
+        _pool.push([&, job]{
+            std::string loadError;
+            try {
+                job->fi = std::shared_ptr<offsetfinder64>(new offsetfinder64(job->path.c_str()));
+                if (_prepare)
+                    _prepare(*job->fi);
+                if (_store)
+                    job->reused = _store->reuse(*job->fi, slide);
+            } catch (tihmstar::exception &e) {
+                loadError = e.what();
+            } catch (std::exception &e) {
+                loadError = e.what();
+            }
+            job->loadMs = msSince(job->start);
+            
+            if (loadError.size() || finders.empty()) {
+                finish(job, loadError);
+                return;
+            }
+            
+            for (size_t i=0; i<finders.size(); i++) {
+                auto reused = job->reused.find(finders[i]->name);
+                if (reused != job->reused.end()) {
+                    job->results[i] = reused->second;
+                    if (--job->pending == 0)
+                        finish(job, "");
+                    continue;
+                }
+                _pool.push([&, job, i, slide]{
+                    std::string res;
+                    if (runFinder(finders[i], slideview(*job->fi, slide), res))
+                        job->results[i] = res;
+                    else
+                        job->errors[i] = res;
+                    if (--job->pending == 0)
+                        finish(job, "");
+                });
+            }
+        });
+    }
+    
+    std::unique_lock<std::mutex> l(_lock);
+    _cond.wait(l, [&]{return remaining == 0;});
+    return failed;
+}
@@ -0,0 +1,128 @@
+//
+//  callgraph.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "callgraph.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/callgraph.hpp>
+#include <liboffsetfinder64/classify.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <algorithm>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+callgraph::callgraph(offsetfinder64 &of){
+    build(of);
+}
+
+void callgraph::build(offsetfinder64 &of){
+    static const insnclassdef bldef = insnclassdefs[kInsnClassBl];
+
+    std::vector<text_t> exec;
+    for (auto &seg : of.segments()) {
+        if (seg.isExec)
+            exec.push_back(seg);
+    }
+    std::sort(exec.begin(), exec.end(), [](const text_t &lhs, const text_t &rhs){
+        return lhs.base < rhs.base;
+    });
+
+    const jumpstubs &stubs = of.jumpStubs();
+    for (auto &seg : exec) {
+        const uint32_t *words = (const uint32_t *)seg.map;
+        size_t n = seg.size / 4;
+        for (size_t blk=0; blk<n; blk+=kClassifyBlockWords) {
+            uint64_t hits = 0;
+            classifyBlock(words+blk, std::min(n-blk, kClassifyBlockWords), &bldef, 1, &hits);
+            for (; hits; hits &= hits-1) {
+                size_t k = blk + __builtin_ctzll(hits);
+                int64_t off = (int64_t)((int32_t)(words[k] << 6) >> 6) * 4;
+                loc_t site = seg.base + 4*k;
+                loc_t target = site + off;
+
+                const jumpstubs::stub *st = stubs.find(target);
+                _calls.push_back({site,target,(st && st->target) ? st->target : target});
+            }
+        }
+    }
+
+    for (auto &c : _calls)
+        _functions.push_back(c.callee);
+    std::sort(_functions.begin(), _functions.end());
+    _functions.erase(std::unique(_functions.begin(), _functions.end()), _functions.end());
+
+    //by caller: functions are intervals, so their calls are already contiguous
+    _calleesOf.resize(_functions.size()+1);
+    for (size_t i=0; i<_functions.size(); i++) {
+        _calleesOf[i] = (uint32_t)(std::lower_bound(_calls.begin(), _calls.end(), _functions[i], [](const call &c, loc_t f){
+            return c.site < f;
+        }) - _calls.begin());
+    }
+    _calleesOf.back() = (uint32_t)_calls.size();
+
+    //by callee
+    _callers = _calls;
+    std::stable_sort(_callers.begin(), _callers.end(), [](const call &lhs, const call &rhs){
+        return lhs.callee < rhs.callee;
+    });
+    _callersOf.resize(_functions.size()+1);
+    size_t pos = 0;
+    for (size_t i=0; i<_functions.size(); i++) {
+        _callersOf[i] = (uint32_t)pos;
+        while (pos < _callers.size() && _callers[pos].callee == _functions[i])
+            pos++;
+    }
+    _callersOf.back() = (uint32_t)_callers.size();
+}
+
+loc_t callgraph::functionFor(loc_t pc) const{
+    auto it = std::upper_bound(_functions.begin(), _functions.end(), pc);
+    return (it == _functions.begin()) ? 0 : *(it-1);
+}
+
+callgraph::range callgraph::callsIn(loc_t pc) const{
+    auto it = std::upper_bound(_functions.begin(), _functions.end(), pc);
+    if (it == _functions.begin())
+        return {NULL,NULL};
+    size_t i = it - _functions.begin() - 1;
+    return {_calls.data() + _calleesOf[i], _calls.data() + _calleesOf[i+1]};
+}
+
+callgraph::range callgraph::callersOf(loc_t callee) const{
+    auto it = std::lower_bound(_functions.begin(), _functions.end(), callee);
+    if (it == _functions.end() || *it != callee)
+        return {NULL,NULL};
+    size_t i = it - _functions.begin();
+    return {_callers.data() + _callersOf[i], _callers.data() + _callersOf[i+1]};
+}
+
+const callgraph::call *callgraph::nthCallAfter(loc_t pc, size_t n) const{
+    retassure(n, "calls are counted from 1");
+    auto it = std::upper_bound(_calls.begin(), _calls.end(), pc, [](loc_t p, const call &c){
+        return p < c.site;
+    });
+    size_t i = (it - _calls.begin()) + n-1;
+    return (i < _calls.size()) ? &_calls[i] : NULL;
+}
+
+const callgraph::call *callgraph::firstCallTo(loc_t callee, loc_t after) const{
+    range r = callersOf(callee);
+    const call *c = std::upper_bound(r.first, r.second, after, [](loc_t p, const call &c){
+        return p < c.site;
+    });
+    return (c != r.second) ? c : NULL;
+}
+
+const callgraph::call *callgraph::lastCallTo(loc_t callee, loc_t before) const{
+    range r = callersOf(callee);
+    const call *c = std::lower_bound(r.first, r.second, before, [](const call &c, loc_t p){
+        return c.site < p;
+    });
+    return (c != r.first) ? c-1 : NULL;
+}
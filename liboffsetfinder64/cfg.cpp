@@ -0,0 +1,259 @@
+//
+//  cfg.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "cfg.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/cfg.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <algorithm>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+static inline int64_t sext(uint64_t v, int bits){
+    return (int64_t)(v << (64-bits)) >> (64-bits);
+}
+
+enum cfg::branchkind cfg::branchInfo(uint32_t i, uint64_t pc, uint64_t &target){
+    if (insn::is_b(i)){
+        target = pc + (sext(BIT_RANGE(i, 0, 25), 26) << 2);
+        return kBranchUncond;
+    }else if (insn::is_bl(i)){
+        target = pc + (sext(BIT_RANGE(i, 0, 25), 26) << 2);
+        return kBranchCall;
+    }else if (insn::is_bcond(i) || insn::is_cbz(i) || insn::is_cbnz(i)){
+        target = pc + (sext(BIT_RANGE(i, 5, 23), 19) << 2);
+        return kBranchCond;
+    }else if (insn::is_tbz(i) || insn::is_tbnz(i)){
+        target = pc + (sext(BIT_RANGE(i, 5, 18), 14) << 2);
+        return kBranchCond;
+    }else if ((i & 0xFE1F0000) == 0xD61F0000 && !BIT_AT(i, 23)){
+        //br, blr, ret and their authenticated variants
+        return (BIT_RANGE(i, 21, 22) == 1) ? kBranchIndirectCall : kBranchIndirect;
+    }
+    return kNoBranch;
+}
+
+cfg::cfg(offsetfinder64 &of, loc_t start, loc_t end) :
+    _start(start),
+    _end(end)
+{
+    const text_t *seg = of.segmentForLoc(_start);
+    retassure(seg && seg->isExec, "function not in exec segment");
+    if (_end > seg->base + seg->size)
+        _end = seg->base + seg->size;
+    retassure(_end > _start, "empty function");
+
+    build((const uint32_t *)(seg->map + (_start - seg->base)));
+    buildDominators();
+}
+
+void cfg::build(const uint32_t *words){
+    size_t n = (_end - _start) / 4;
+    std::vector<uint8_t> leader(n+1,0);
+    leader[0] = 1;
+
+    auto targetIdx = [&](uint64_t target, size_t &t)->bool{
+        if (target < (uint64_t)_start || target >= (uint64_t)_end || (target & 3))
+            return false;
+        t = (target - (uint64_t)_start)/4;
+        return true;
+    };
+
+    for (size_t k=0; k<n; k++) {
+        uint64_t target = 0;
+        size_t t = 0;
+        switch (branchInfo(words[k], (uint64_t)_start + 4*k, target)) {
+            case kBranchCond:
+            case kBranchUncond:
+                leader[k+1] = 1;
+                if (targetIdx(target, t))
+                    leader[t] = 1;
+                break;
+            case kBranchIndirect:
+                leader[k+1] = 1;
+                break;
+            default:
+                break;
+        }
+    }
+
+    _blocks.clear();
+    for (size_t k=0; k<n; k++) {
+        if (!leader[k])
+            continue;
+        if (_blocks.size())
+            _blocks.back().end = _start + 4*k;
+        block b = {};
+        b.start = _start + 4*k;
+        b.idom = -1;
+        b.domcond = -1;
+        _blocks.push_back(b);
+    }
+    _blocks.back().end = _end;
+
+    //successors
+    _succs.clear();
+    for (size_t bi=0; bi<_blocks.size(); bi++) {
+        block &b = _blocks[bi];
+        loc_t last = b.end-4;
+        uint64_t target = 0;
+        size_t t = 0;
+        enum branchkind kind = branchInfo(words[(last - _start)/4], (uint64_t)last, target);
+
+        b.succOff = (uint32_t)_succs.size();
+        if ((kind == kBranchCond || kind == kBranchUncond) && targetIdx(target, t))
+            _succs.push_back({(uint32_t)blockIndex((loc_t)target),last});
+        if (kind != kBranchUncond && kind != kBranchIndirect && bi+1 < _blocks.size())
+            _succs.push_back({(uint32_t)bi+1,0});
+        b.succCnt = (uint32_t)_succs.size() - b.succOff;
+    }
+
+    //predecessors, counting sort over the successor array
+    _preds.resize(_succs.size());
+    for (auto &b : _blocks) b.predCnt = 0;
+    for (auto &e : _succs) _blocks[e.block].predCnt++;
+    uint32_t off = 0;
+    for (auto &b : _blocks) {
+        b.predOff = off;
+        off += b.predCnt;
+        b.predCnt = 0;
+    }
+    for (size_t bi=0; bi<_blocks.size(); bi++) {
+        const block &b = _blocks[bi];
+        for (uint32_t j=b.succOff; j<b.succOff+b.succCnt; j++) {
+            block &dst = _blocks[_succs[j].block];
+            _preds[dst.predOff + dst.predCnt++] = {(uint32_t)bi,_succs[j].branch};
+        }
+    }
+}
+
+void cfg::buildDominators(){
+    //Cooper, Harvey, Kennedy - "A Simple, Fast Dominance Algorithm"
+    size_t n = _blocks.size();
+    std::vector<int32_t> rpo;
+    std::vector<int32_t> order(n,-1);
+    std::vector<uint8_t> visited(n,0);
+    std::vector<std::pair<uint32_t,uint32_t>> stack; //block, next successor
+
+    rpo.reserve(n);
+    stack.push_back({0,0});
+    visited[0] = 1;
+    while (stack.size()) {
+        auto &top = stack.back();
+        const block &b = _blocks[top.first];
+        if (top.second < b.succCnt) {
+            uint32_t s = _succs[b.succOff + top.second++].block;
+            if (!visited[s]) {
+                visited[s] = 1;
+                stack.push_back({s,0});
+            }
+        }else{
+            rpo.push_back(top.first);
+            stack.pop_back();
+        }
+    }
+    std::reverse(rpo.begin(), rpo.end());
+    for (size_t i=0; i<rpo.size(); i++)
+        order[rpo[i]] = (int32_t)i;
+
+    auto intersect = [&](int32_t a, int32_t b)->int32_t{
+        while (a != b) {
+            while (order[a] > order[b]) a = _blocks[a].idom;
+            while (order[b] > order[a]) b = _blocks[b].idom;
+        }
+        return a;
+    };
+
+    _blocks[0].idom = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i=1; i<rpo.size(); i++) {
+            block &b = _blocks[rpo[i]];
+            int32_t newidom = -1;
+            for (uint32_t j=b.predOff; j<b.predOff+b.predCnt; j++) {
+                int32_t p = _preds[j].block;
+                if (order[p] == -1 || _blocks[p].idom == -1)
+                    continue;
+                newidom = (newidom == -1) ? p : intersect(p, newidom);
+            }
+            if (newidom != b.idom) {
+                b.idom = newidom;
+                changed = true;
+            }
+        }
+    }
+    _blocks[0].idom = -1;
+
+    //dominating conditions, in rpo so a blocks dominator is always done first
+    for (size_t i=1; i<rpo.size(); i++) {
+        int32_t bi = rpo[i];
+        block &b = _blocks[bi];
+        int32_t d = b.idom;
+        if (d == -1)
+            continue;
+        const block &db = _blocks[d];
+
+        //this block is guarded by d's branch if d is our only way in and d branches two ways
+        if (db.succCnt == 2 && b.predCnt == 1 && _succs[db.succOff].block != _succs[db.succOff+1].block) {
+            b.domcond = d;
+            b.domcondTaken = _preds[b.predOff].branch != 0;
+        }else{
+            b.domcond = db.domcond;
+            b.domcondTaken = db.domcondTaken;
+        }
+    }
+}
+
+size_t cfg::blockIndex(loc_t pc) const{
+    retassure(pc >= _start && pc < _end, "pc not in function");
+    auto it = std::upper_bound(_blocks.begin(), _blocks.end(), pc, [](loc_t p, const block &b){
+        return p < b.start;
+    });
+    return (it - _blocks.begin()) - 1;
+}
+
+std::pair<const cfg::edge*, const cfg::edge*> cfg::successors(size_t bi) const{
+    const block &b = _blocks.at(bi);
+    const edge *base = _succs.data() + b.succOff;
+    return {base, base + b.succCnt};
+}
+
+std::pair<const cfg::edge*, const cfg::edge*> cfg::predecessors(size_t bi) const{
+    const block &b = _blocks.at(bi);
+    const edge *base = _preds.data() + b.predOff;
+    return {base, base + b.predCnt};
+}
+
+std::vector<loc_t> cfg::branchesTo(loc_t pc) const{
+    std::vector<loc_t> ret;
+    auto preds = predecessors(blockIndex(pc));
+    for (const edge *e = preds.first; e != preds.second; e++) {
+        if (e->branch)
+            ret.push_back(e->branch);
+    }
+    return ret;
+}
+
+loc_t cfg::dominatingCondition(loc_t pc, bool *taken) const{
+    const block &b = blockAt(pc);
+    if (b.domcond == -1)
+        return 0;
+    if (taken) *taken = b.domcondTaken;
+    return _blocks[b.domcond].end-4;
+}
+
+bool cfg::dominates(size_t a, size_t b) const{
+    for (int32_t cur = (int32_t)b; cur != -1; cur = _blocks[cur].idom) {
+        if ((size_t)cur == a)
+            return true;
+    }
+    return false;
+}
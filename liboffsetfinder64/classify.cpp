@@ -0,0 +1,125 @@
+//
+//  classify.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "classify.cpp"
+
+#include <liboffsetfinder64/classify.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <string.h>
+
+#if defined(__x86_64__)
+#   include <immintrin.h>
+#   define CLASSIFY_X86 1
+#elif defined(__aarch64__)
+#   include <arm_neon.h>
+#   define CLASSIFY_NEON 1
+#endif
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+const insnclassdef patchfinder64::insnclassdefs[kInsnClassCount] = {
+    {0x9F000000, 0x90000000}, //adrp
+    {0x9F000000, 0x10000000}, //adr
+    {0x1F000000, 0x11000000}, //add/sub (immediate)
+    {0xFC000000, 0x94000000}, //bl
+    {0xFC000000, 0x14000000}, //b
+    {0xFF000010, 0x54000000}, //b.cond
+    {0x7F000000, 0x34000000}, //cbz
+    {0x7F000000, 0x35000000}, //cbnz
+    {0x7F000000, 0x36000000}, //tbz
+    {0x7F000000, 0x37000000}, //tbnz
+    {0xBFC00000, 0xB9400000}, //ldr (unsigned offset)
+    {0xBFC00000, 0xB9000000}, //str (unsigned offset)
+    {0x7E400000, 0x28000000}, //stp
+    {0x7F800000, 0x52800000}, //movz
+    {0xFFFFFC1F, 0xD65F0000}, //ret
+    {0xFFFFFC1F, 0xD61F0000}, //br
+};
+
+static void classifyScalar(const uint32_t *words, size_t start, size_t n, const insnclassdef *defs, size_t ndefs, uint64_t *out){
+    for (size_t k=start; k<n; k++) {
+        uint32_t w = words[k];
+        for (size_t c=0; c<ndefs; c++)
+            out[c] |= (uint64_t)((w & defs[c].mask) == defs[c].value) << k;
+    }
+}
+
+#ifdef CLASSIFY_X86
+__attribute__((target("avx2")))
+static void classifyAVX2(const uint32_t *words, size_t n, const insnclassdef *defs, size_t ndefs, uint64_t *out){
+    size_t k = 0;
+    for (; k+8 <= n; k+=8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(words+k));
+        for (size_t c=0; c<ndefs; c++) {
+            __m256i hit = _mm256_cmpeq_epi32(_mm256_and_si256(v, _mm256_set1_epi32((int)defs[c].mask)), _mm256_set1_epi32((int)defs[c].value));
+            out[c] |= (uint64_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(hit)) << k;
+        }
+    }
+    classifyScalar(words, k, n, defs, ndefs, out);
+}
+
+static void classifySSE2(const uint32_t *words, size_t n, const insnclassdef *defs, size_t ndefs, uint64_t *out){
+    size_t k = 0;
+    for (; k+4 <= n; k+=4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(words+k));
+        for (size_t c=0; c<ndefs; c++) {
+            __m128i hit = _mm_cmpeq_epi32(_mm_and_si128(v, _mm_set1_epi32((int)defs[c].mask)), _mm_set1_epi32((int)defs[c].value));
+            out[c] |= (uint64_t)(uint32_t)_mm_movemask_ps(_mm_castsi128_ps(hit)) << k;
+        }
+    }
+    classifyScalar(words, k, n, defs, ndefs, out);
+}
+
+static bool haveAVX2(){
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+#endif
+
+#ifdef CLASSIFY_NEON
+static void classifyNEON(const uint32_t *words, size_t n, const insnclassdef *defs, size_t ndefs, uint64_t *out){
+    static const uint32_t lanebits[4] = {1,2,4,8};
+    uint32x4_t bits = vld1q_u32(lanebits);
+    size_t k = 0;
+    for (; k+4 <= n; k+=4) {
+        uint32x4_t v = vld1q_u32(words+k);
+        for (size_t c=0; c<ndefs; c++) {
+            uint32x4_t hit = vceqq_u32(vandq_u32(v, vdupq_n_u32(defs[c].mask)), vdupq_n_u32(defs[c].value));
+            out[c] |= (uint64_t)vaddvq_u32(vandq_u32(hit, bits)) << k;
+        }
+    }
+    classifyScalar(words, k, n, defs, ndefs, out);
+}
+#endif
+
+void patchfinder64::classifyBlock(const uint32_t *words, size_t n, const insnclassdef *defs, size_t ndefs, uint64_t *out){
+    if (n > kClassifyBlockWords)
+        n = kClassifyBlockWords;
+    memset(out, 0, ndefs*sizeof(*out));
+#if defined(CLASSIFY_X86)
+    if (haveAVX2())
+        classifyAVX2(words, n, defs, ndefs, out);
+    else
+        classifySSE2(words, n, defs, ndefs, out);
+#elif defined(CLASSIFY_NEON)
+    classifyNEON(words, n, defs, ndefs, out);
+#else
+    classifyScalar(words, 0, n, defs, ndefs, out);
+#endif
+}
+
+const char *patchfinder64::classifyImplementation(){
+#if defined(CLASSIFY_X86)
+    return haveAVX2() ? "avx2" : "sse2";
+#elif defined(CLASSIFY_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
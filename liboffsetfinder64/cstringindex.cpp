@@ -0,0 +1,109 @@
+//
+//  cstringindex.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "cstringindex.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/cstringindex.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <algorithm>
+#include <string.h>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+cstringindex::cstringindex(offsetfinder64 &of){
+    for (auto &s : of.sections("__cstring"))
+        addSection(of, s.first, s.second);
+    for (auto &s : of.sections("__os_log"))
+        addSection(of, s.first, s.second);
+
+    std::sort(_entries.begin(), _entries.end(), [](const entry &lhs, const entry &rhs){
+        return lhs.hash < rhs.hash || (lhs.hash == rhs.hash && lhs.loc < rhs.loc);
+    });
+    std::sort(_sections.begin(), _sections.end(), [](const section &lhs, const section &rhs){
+        return lhs.base < rhs.base;
+    });
+}
+
+uint64_t cstringindex::hash(const char *str, size_t len){
+    //FNV-1a
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i=0; i<len; i++)
+        h = (h ^ (uint8_t)str[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+void cstringindex::addSection(offsetfinder64 &of, loc_t base, size_t size){
+    const uint8_t *map = (const uint8_t *)of.memoryForLoc(base, size);
+    if (!map)
+        return;
+    _sections.push_back({base,map,size});
+
+    const uint8_t *p = map;
+    const uint8_t *end = map + size;
+    while (p < end) {
+        const uint8_t *nul = (const uint8_t *)memchr(p, 0, end-p);
+        if (!nul)
+            break; //unterminated tail
+        if (nul != p)
+            _entries.push_back({hash((const char *)p, nul-p),(loc_t)(base + (p-map)),(const char *)p,(size_t)(nul-p)});
+        p = nul+1;
+    }
+}
+
+std::vector<loc_t> cstringindex::findAll(const char *str, size_t len) const{
+    std::vector<loc_t> ret;
+    uint64_t h = hash(str, len);
+    auto it = std::lower_bound(_entries.begin(), _entries.end(), h, [](const entry &e, uint64_t h){
+        return e.hash < h;
+    });
+    for (; it != _entries.end() && it->hash == h; ++it) {
+        if (it->len == len && memcmp(it->str, str, len) == 0)
+            ret.push_back(it->loc);
+    }
+    return ret;
+}
+
+loc_t cstringindex::find(const char *str, size_t len) const{
+    uint64_t h = hash(str, len);
+    auto it = std::lower_bound(_entries.begin(), _entries.end(), h, [](const entry &e, uint64_t h){
+        return e.hash < h;
+    });
+    for (; it != _entries.end() && it->hash == h; ++it) {
+        if (it->len == len && memcmp(it->str, str, len) == 0)
+            return it->loc; //sorted by loc within a hash
+    }
+    return 0;
+}
+
+const char *cstringindex::stringAt(loc_t loc, size_t *len) const{
+    auto it = std::upper_bound(_sections.begin(), _sections.end(), loc, [](loc_t l, const section &s){
+        return l < s.base;
+    });
+    if (it == _sections.begin())
+        return NULL;
+    const section &s = *(it-1);
+    if (loc >= s.base + s.size)
+        return NULL;
+    const char *str = (const char *)s.map + (loc - s.base);
+    const char *nul = (const char *)memchr(str, 0, s.size - (loc - s.base));
+    if (!nul)
+        return NULL;
+    if (len)
+        *len = nul - str;
+    return str;
+}
+
+loc_t cstringindex::search(const void *little, size_t little_len) const{
+    for (auto &s : _sections) {
+        if (const uint8_t *rt = (const uint8_t *)::memmem(s.map, s.size, little, little_len))
+            return s.base + (rt - s.map);
+    }
+    return 0;
+}
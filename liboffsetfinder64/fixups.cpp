@@ -0,0 +1,217 @@
+//
+//  fixups.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "fixups.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/fixups.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <mach-o/loader.h>
+#include <algorithm>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+#ifndef LC_DYLD_CHAINED_FIXUPS
+#define LC_DYLD_CHAINED_FIXUPS 0x80000034
+#endif
+
+#define DYLD_CHAINED_PTR_START_NONE 0xFFFF
+#define DYLD_CHAINED_PTR_START_MULTI 0x8000
+#define THREAD_STARTS_END 0xFFFFFFFF
+
+struct dyld_chained_fixups_header_raw{
+    uint32_t fixups_version;
+    uint32_t starts_offset;
+    uint32_t imports_offset;
+    uint32_t symbols_offset;
+    uint32_t imports_count;
+    uint32_t imports_format;
+    uint32_t symbols_format;
+};
+
+struct dyld_chained_starts_in_segment_raw{
+    uint32_t size;
+    uint16_t page_size;
+    uint16_t pointer_format;
+    uint64_t segment_offset;
+    uint32_t max_valid_pointer;
+    uint16_t page_count;
+    uint16_t page_start[1];
+} __attribute__((packed));
+
+static inline uint64_t sext(uint64_t v, int bits){
+    return (uint64_t)((int64_t)(v << (64-bits)) >> (64-bits));
+}
+
+chainedfixups::chainedfixups(offsetfinder64 &of) :
+    _of(of),
+    _base(of.find_base())
+{
+    const uint8_t *kdata = (const uint8_t *)of.kdata();
+    size_t ksize = of.ksize();
+    const struct mach_header_64 *mh = (const struct mach_header_64 *)kdata;
+    const struct load_command *lcmd = (const struct load_command *)(mh + 1);
+    
+    for (uint32_t i=0; i<mh->ncmds; i++, lcmd = (const struct load_command *)((const uint8_t *)lcmd + lcmd->cmdsize)) {
+        if (lcmd->cmd == LC_DYLD_CHAINED_FIXUPS) {
+            const struct linkedit_data_command *ld = (const struct linkedit_data_command *)lcmd;
+            retassure((uint64_t)ld->dataoff + ld->datasize <= ksize, "LC_DYLD_CHAINED_FIXUPS out of bounds");
+            parseChainedFixups(kdata + ld->dataoff, ld->datasize);
+        }else if (lcmd->cmd == LC_SEGMENT_64) {
+            const struct segment_command_64 *seg = (const struct segment_command_64 *)lcmd;
+            const struct section_64 *sect = (const struct section_64 *)(seg + 1);
+            for (uint32_t j=0; j<seg->nsects; j++, sect++) {
+                if (strncmp(sect->sectname, "__thread_starts", sizeof(sect->sectname)) != 0)
+                    continue;
+                retassure((uint64_t)sect->offset + sect->size <= ksize, "__thread_starts out of bounds");
+                parseThreadStarts(kdata + sect->offset, sect->size);
+            }
+        }
+    }
+    
+    std::sort(_chains.begin(), _chains.end(), [](const chain &a, const chain &b){
+        return a.start < b.start;
+    });
+    _shadows.resize(of.segments().size());
+    _shadowOnce.reset(new std::once_flag[of.segments().size()]);
+}
+
+void chainedfixups::parseChainedFixups(const uint8_t *data, size_t size){
+    retassure(size >= sizeof(dyld_chained_fixups_header_raw), "chained fixups header truncated");
+    const dyld_chained_fixups_header_raw *hdr = (const dyld_chained_fixups_header_raw *)data;
+    retassure(hdr->starts_offset + sizeof(uint32_t) <= size, "chained fixups starts out of bounds");
+    
+    const uint8_t *starts = data + hdr->starts_offset;
+    uint32_t segCount = *(const uint32_t *)starts;
+    retassure(hdr->starts_offset + sizeof(uint32_t)*(1+segCount) <= size, "chained fixups starts out of bounds");
+    const uint32_t *segInfoOffsets = (const uint32_t *)starts + 1;
+    
+    for (uint32_t i=0; i<segCount; i++) {
+        if (!segInfoOffsets[i])
+            continue;
+        size_t infoOff = hdr->starts_offset + segInfoOffsets[i];
+        retassure(infoOff + offsetof(dyld_chained_starts_in_segment_raw, page_start) <= size, "segment starts out of bounds");
+        const dyld_chained_starts_in_segment_raw *seg = (const dyld_chained_starts_in_segment_raw *)(data + infoOff);
+        retassure(infoOff + offsetof(dyld_chained_starts_in_segment_raw, page_start) + seg->page_count*sizeof(uint16_t) <= size, "segment page starts out of bounds");
+        
+        switch (seg->pointer_format) {
+            case kPtrArm64e:
+            case kPtr64:
+            case kPtr64Offset:
+            case kPtrArm64eKernel:
+            case kPtr64KernelCache:
+                break;
+            default:
+                reterror("unsupported chained pointer format " + std::to_string(seg->pointer_format));
+        }
+        
+        for (uint16_t p=0; p<seg->page_count; p++) {
+            uint16_t start = seg->page_start[p];
+            if (start == DYLD_CHAINED_PTR_START_NONE)
+                continue;
+            retassure(!(start & DYLD_CHAINED_PTR_START_MULTI), "multi start pages are 32bit only");
+            _chains.push_back({_base + seg->segment_offset + (uint64_t)p*seg->page_size + start, seg->pointer_format});
+        }
+    }
+}
+
+void chainedfixups::parseThreadStarts(const uint8_t *data, size_t size){
+    retassure(size >= sizeof(uint32_t), "__thread_starts truncated");
+    const uint32_t *starts = (const uint32_t *)data;
+    uint16_t format = (starts[0] & 1) ? kPtrThreadStarts8 : kPtrThreadStarts4;
+    
+    for (size_t i=1; i<size/sizeof(uint32_t); i++) {
+        if (starts[i] == THREAD_STARTS_END)
+            break;
+        _chains.push_back({_base + starts[i], format});
+    }
+}
+
+uint64_t chainedfixups::decode(uint64_t raw, uint16_t format, loc_t base, uint32_t *nextDelta){
+    bool auth = raw >> 63;
+    uint32_t next = 0;
+    uint32_t stride = 4;
+    uint64_t ret = raw;
+    
+    switch (format) {
+        case kPtrArm64e:
+        case kPtrArm64eKernel:
+            stride = (format == kPtrArm64e) ? 8 : 4;
+            next = BIT_RANGE(raw, 51, 61);
+            if (BIT_AT(raw, 62))
+                break; //bind, nothing to rebase
+            if (auth)
+                ret = (uint64_t)base + (raw & 0xffffffff);
+            else if (format == kPtrArm64e)
+                ret = sext(raw & ((1ULL<<43)-1), 43) | (BIT_RANGE(raw, 43, 50) << 56);
+            else
+                ret = ((uint64_t)base + (raw & ((1ULL<<43)-1))) | (BIT_RANGE(raw, 43, 50) << 56);
+            break;
+        case kPtr64:
+        case kPtr64Offset:
+            next = BIT_RANGE(raw, 51, 62);
+            if (auth)
+                break; //bind
+            ret = (raw & ((1ULL<<36)-1)) | (BIT_RANGE(raw, 36, 43) << 56);
+            if (format == kPtr64Offset)
+                ret += (uint64_t)base;
+            break;
+        case kPtr64KernelCache:
+            next = BIT_RANGE(raw, 51, 62);
+            ret = (uint64_t)base + (raw & 0x3fffffff);
+            break;
+        case kPtrThreadStarts4:
+        case kPtrThreadStarts8:
+            stride = (format == kPtrThreadStarts8) ? 8 : 4;
+            next = BIT_RANGE(raw, 51, 61);
+            if (BIT_AT(raw, 62))
+                break; //bind
+            ret = auth ? (uint64_t)base + (raw & 0xffffffff) : sext(raw, 51);
+            break;
+        default:
+            reterror("unsupported chained pointer format " + std::to_string(format));
+    }
+    
+    if (nextDelta)
+        *nextDelta = next * stride;
+    return ret;
+}
+
+void chainedfixups::buildShadow(size_t segidx){
+    const text_t &seg = _of.segments()[segidx];
+    std::vector<uint8_t> &shadow = _shadows[segidx];
+    shadow.assign((const uint8_t *)seg.map, (const uint8_t *)seg.map + seg.size);
+    
+    auto it = std::lower_bound(_chains.begin(), _chains.end(), seg.base, [](const chain &c, loc_t b){
+        return c.start < b;
+    });
+    for (; it != _chains.end() && it->start < seg.base + seg.size; ++it) {
+        uint32_t delta = 0;
+        for (loc_t cur = it->start; cur + sizeof(uint64_t) <= seg.base + seg.size; cur += delta) {
+            uint64_t raw = 0;
+            memcpy(&raw, seg.map + (cur - seg.base), sizeof(raw));
+            uint64_t val = decode(raw, it->format, _base, &delta);
+            memcpy(&shadow[cur - seg.base], &val, sizeof(val));
+            if (!delta)
+                break;
+        }
+    }
+}
+
+const void *chainedfixups::rebasedMemoryForLoc(loc_t pos, size_t size){
+    const text_t *seg = _of.segmentForLoc(pos);
+    if (!seg || pos + size > seg->base + seg->size)
+        return NULL;
+    if (seg->isExec)
+        return seg->map + (pos - seg->base); //no pointers in code
+    
+    size_t segidx = seg - _of.segments().data();
+    std::call_once(_shadowOnce[segidx], [this,segidx]{buildShadow(segidx);});
+    return _shadows[segidx].data() + (pos - seg->base);
+}
@@ -11,6 +11,8 @@
 #include "all_liboffsetfinder.hpp"
 #include <liboffsetfinder64/insn.hpp>
 #include <liboffsetfinder64/OFexception.hpp>
+#include <liboffsetfinder64/classify.hpp>
+#include <liboffsetfinder64/insnindex.hpp>
 
 using namespace tihmstar::patchfinder64;
 
@@ -350,6 +352,9 @@ bool insn::is_nop(uint32_t i){
     return (BIT_RANGE(i, 12, 31) == 0b11010101000000110010) && (0b11111 % (1<<5));
 }
 
+uint64_t insn::decode_logical_imm(uint32_t i){
+    return AArch64_AM_decodeLogicalImmediate(BIT_RANGE(i, 10, 22), (i>>31) ? 64 : 32);
+}
 
 enum insn::type insn::type(){
     uint32_t val = value();
@@ -605,41 +610,68 @@ insn::operator enum type(){
     return type();
 }
 
+#pragma mark seeking
+insn &insn::nextOf(enum type t, const insnindex &index){
+    loc_t p = index.nextOf(t, _p.first);
+    if (!p)
+        throw out_of_range("overflow");
+    return *this = p;
+}
+
+insn &insn::prevOf(enum type t, const insnindex &index){
+    loc_t p = index.prevOf(t, _p.first);
+    if (!p)
+        throw out_of_range("underflow");
+    return *this = p;
+}
+
 #pragma mark additional functions
 loc_t tihmstar::patchfinder64::find_literal_ref(segment_t segemts, loc_t pos, int ignoreTimes){
-    insn adrp(segemts);
+    //only adr, adrp and add can form a reference, classify in blocks and decode just those
+    static const insnclassdef refdefs[3] = {
+        insnclassdefs[kInsnClassAdr],
+        insnclassdefs[kInsnClassAdrp],
+        insnclassdefs[kInsnClassAddSubImm]
+    };
+    std::sort(segemts.begin(),segemts.end(),[ ]( const text_t& lhs, const text_t& rhs){
+        return lhs.base < rhs.base;
+    });
     uint8_t rd = 0xff;
     uint64_t imm = 0;
     
-    try {
-        for (;;++adrp){
-            if (adrp == insn::adr) {
-                if (adrp.imm() == (uint64_t)pos){
-                    if (ignoreTimes) {
-                        ignoreTimes--;
-                        rd = 0xff;
-                        imm = 0;
+    for (auto &seg : segemts) {
+        if (!seg.isExec)
+            continue;
+        const uint32_t *words = (const uint32_t *)seg.map;
+        size_t n = seg.size/4;
+        for (size_t blk=0; blk<n; blk+=kClassifyBlockWords) {
+            uint64_t hits[3];
+            classifyBlock(words+blk, n-blk, refdefs, 3, hits);
+            for (uint64_t todo = hits[0] | hits[1] | hits[2]; todo; todo &= todo-1) {
+                unsigned k = __builtin_ctzll(todo);
+                uint32_t i = words[blk+k];
+                uint64_t pc = (uint64_t)seg.base + 4*(blk+k);
+                
+                if (BIT_AT(hits[0], k)) {
+                    if (pc + signExtend64((BIT_RANGE(i, 5, 23)<<2) | (BIT_RANGE(i, 29, 30)), 21) != (uint64_t)pos)
                         continue;
-                    }
-                    return (loc_t)adrp.pc();
+                }else if (BIT_AT(hits[1], k)) {
+                    rd = i % (1<<5);
+                    imm = ((pc>>12)<<12) + signExtend64(((((i % (1<<24))>>5)<<2) | BIT_RANGE(i, 29, 30))<<12,32);
+                    continue;
+                }else if (rd != i % (1<<5) || imm + (BIT_RANGE(i, 10, 21) << (((i>>22)&1) * 12)) != (uint64_t)pos) {
+                    continue;
                 }
-            }else if (adrp == insn::adrp) {
-                rd = adrp.rd();
-                imm = adrp.imm();
-            }else if (adrp == insn::add && rd == adrp.rd()){
-                if (imm + adrp.imm() == (int64_t)pos){
-                    if (ignoreTimes) {
-                        ignoreTimes--;
-                        rd = 0xff;
-                        imm = 0;
-                        continue;
-                    }
-                    return (loc_t)adrp.pc();
+                
+                if (ignoreTimes) {
+                    ignoreTimes--;
+                    rd = 0xff;
+                    imm = 0;
+                    continue;
                 }
+                return (loc_t)pc;
             }
         }
-    } catch (std::out_of_range &e) {
-        return 0;
     }
     return 0;
 }
@@ -0,0 +1,207 @@
+//
+//  insnindex.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "insnindex.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/insnindex.hpp>
+#include <liboffsetfinder64/classify.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <algorithm>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+/*
+ the insn::is_* predicates as mask/value pairs.
+ A type matches if any of its pairs matches and its exclude pair doesn't.
+ */
+static const insnclassdef typedefs[] = {
+    {0x9F000000, 0x90000000}, // 0 adrp
+    {0x9F000000, 0x10000000}, // 1 adr
+    {0x1F000000, 0x11000000}, // 2 add
+    {0xFC000000, 0x94000000}, // 3 bl
+    {0x7F000000, 0x34000000}, // 4 cbz
+    {0xFFFFFC1F, 0xD65F0000}, // 5 ret
+    {0x7F000000, 0x37000000}, // 6 tbnz
+    {0xFFFFFC1F, 0xD61F0000}, // 7 br
+    {0xBFC00000, 0xB8400000}, // 8 ldr (immediate, post/pre-indexed and register)
+    {0xBFC00000, 0xB9400000}, // 9 ldr (immediate, unsigned offset)
+    {0xFF800000, 0x0C000000}, //10 ldr (literal), as matched by is_ldr
+    {0xBFC00C00, 0xB8400000}, //11 not ldr: unscaled form of 8
+    {0x7F000000, 0x35000000}, //12 cbnz
+    {0x7F800000, 0x72800000}, //13 movk
+    {0x7F800000, 0x32000000}, //14 orr
+    {0x7F800000, 0x12000000}, //15 and
+    {0x7F000000, 0x36000000}, //16 tbz
+    {0xBF400000, 0x88400000}, //17 ldxr
+    {0xFFE00000, 0x38400000}, //18 ldrb (immediate, post/pre-indexed)
+    {0xFFC00000, 0x39400000}, //19 ldrb (immediate, unsigned offset)
+    {0xFFE00C00, 0x38600800}, //20 ldrb (register)
+    {0xBFC00000, 0xB9000000}, //21 str
+    {0x7E400000, 0x28000000}, //22 stp
+    {0x7F800000, 0x52800000}, //23 movz
+    {0xFF000010, 0x54000000}, //24 b.cond
+    {0xFC000000, 0x14000000}, //25 b
+    {0xFFFFF000, 0xD5032000}, //26 nop
+};
+static const size_t kTypeDefCount = sizeof(typedefs)/sizeof(*typedefs);
+
+struct typerule{
+    enum insn::type type;
+    uint8_t first;  //first pair in typedefs
+    uint8_t count;
+    int8_t exclude; //pair in typedefs, -1 if none
+};
+
+//same precedence as insn::type()
+static const typerule typerules[] = {
+    {insn::adrp,   0, 1, -1},
+    {insn::adr,    1, 1, -1},
+    {insn::add,    2, 1, -1},
+    {insn::bl,     3, 1, -1},
+    {insn::cbz,    4, 1, -1},
+    {insn::ret,    5, 1, -1},
+    {insn::tbnz,   6, 1, -1},
+    {insn::br,     7, 1, -1},
+    {insn::ldr,    8, 3, 11},
+    {insn::cbnz,  12, 1, -1},
+    {insn::movk,  13, 1, -1},
+    {insn::orr,   14, 1, -1},
+    {insn::and_,  15, 1, -1},
+    {insn::tbz,   16, 1, -1},
+    {insn::ldxr,  17, 1, -1},
+    {insn::ldrb,  18, 3, -1},
+    {insn::str,   21, 1, -1},
+    {insn::stp,   22, 1, -1},
+    {insn::movz,  23, 1, -1},
+    {insn::bcond, 24, 1, -1},
+    {insn::b,     25, 1, -1},
+    {insn::nop,   26, 1, -1},
+};
+
+insnindex::insnindex(offsetfinder64 &of){
+    build(of.segments());
+}
+
+insnindex::insnindex(const segment_t &segments){
+    build(segments);
+}
+
+void insnindex::build(const segment_t &segments){
+    std::vector<text_t> exec;
+    for (auto &seg : segments) {
+        if (seg.isExec && seg.size >= 4)
+            exec.push_back(seg);
+    }
+    std::sort(exec.begin(), exec.end(), [](const text_t &lhs, const text_t &rhs){
+        return lhs.base < rhs.base;
+    });
+
+    size_t blocks = 0;
+    for (auto &seg : exec) {
+        _ranges.push_back({seg.base, seg.size/4, blocks});
+        blocks += (seg.size/4 + kClassifyBlockWords-1) / kClassifyBlockWords;
+    }
+    for (auto &bits : _bits)
+        bits.assign(blocks, 0);
+
+    uint64_t hits[kTypeDefCount];
+    for (size_t r=0; r<exec.size(); r++) {
+        const uint32_t *words = (const uint32_t *)exec[r].map;
+        size_t n = _ranges[r].words;
+        size_t block = _ranges[r].block;
+        for (size_t blk=0; blk<n; blk+=kClassifyBlockWords, block++) {
+            size_t cnt = std::min(n-blk, kClassifyBlockWords);
+            classifyBlock(words+blk, cnt, typedefs, kTypeDefCount, hits);
+
+            uint64_t taken = 0;
+            for (auto &rule : typerules) {
+                uint64_t m = 0;
+                for (size_t d=rule.first; d<rule.first+rule.count; d++)
+                    m |= hits[d];
+                if (rule.exclude >= 0)
+                    m &= ~hits[rule.exclude];
+                m &= ~taken;
+                taken |= m;
+                _bits[rule.type][block] = m;
+            }
+            uint64_t valid = (cnt == 64) ? ~0ull : ((1ull << cnt) - 1);
+            _bits[insn::unknown][block] = valid & ~taken;
+        }
+    }
+}
+
+const insnindex::range *insnindex::rangeFor(loc_t pc, bool after) const{
+    //first range starting after pc
+    auto it = std::upper_bound(_ranges.begin(), _ranges.end(), pc, [](loc_t p, const range &r){
+        return p < r.base;
+    });
+    if (it != _ranges.begin()) {
+        const range &prev = *(it-1);
+        if (pc < prev.base + 4*prev.words || !after)
+            return &prev;
+    }
+    return (it == _ranges.end() || !after) ? NULL : &*it;
+}
+
+loc_t insnindex::nextOf(enum insn::type t, loc_t pc) const{
+    retassure(t < kTypeCount, "bad instruction type");
+    const range *r = rangeFor(pc, true);
+    if (!r)
+        return 0;
+    size_t w = (pc >= r->base) ? (pc - r->base)/4 + 1 : 0;
+    for (; r < _ranges.data() + _ranges.size(); r++, w = 0) {
+        const uint64_t *bits = _bits[t].data() + r->block;
+        for (size_t b=w/64; 64*b < r->words; b++) {
+            uint64_t m = bits[b];
+            if (b == w/64)
+                m &= ~0ull << (w%64);
+            if (m)
+                return r->base + 4*(64*b + __builtin_ctzll(m));
+        }
+    }
+    return 0;
+}
+
+loc_t insnindex::prevOf(enum insn::type t, loc_t pc) const{
+    retassure(t < kTypeCount, "bad instruction type");
+    const range *r = rangeFor(pc, false);
+    if (!r)
+        return 0;
+    size_t end = std::min<size_t>((pc - r->base)/4, r->words); //words before pc
+    while (true) {
+        const uint64_t *bits = _bits[t].data() + r->block;
+        for (size_t b=(end+63)/64; b-- > 0;) {
+            uint64_t m = bits[b];
+            size_t n = end - 64*b;
+            if (n < 64)
+                m &= (1ull << n) - 1;
+            if (m)
+                return r->base + 4*(64*b + 63 - __builtin_clzll(m));
+        }
+        if (r == _ranges.data())
+            return 0;
+        end = (--r)->words;
+    }
+}
+
+size_t insnindex::count(enum insn::type t) const{
+    retassure(t < kTypeCount, "bad instruction type");
+    size_t ret = 0;
+    for (uint64_t m : _bits[t])
+        ret += __builtin_popcountll(m);
+    return ret;
+}
+
+size_t insnindex::memorySize() const{
+    size_t ret = _ranges.size() * sizeof(range);
+    for (auto &bits : _bits)
+        ret += bits.size() * sizeof(uint64_t);
+    return ret;
+}
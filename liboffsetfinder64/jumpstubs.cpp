@@ -0,0 +1,115 @@
+//
+//  jumpstubs.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "jumpstubs.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/jumpstubs.hpp>
+#include <liboffsetfinder64/classify.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <algorithm>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+#define KERNEL_PTR_TAG 0xffff000000000000ULL
+
+jumpstubs::jumpstubs(offsetfinder64 &of) :
+    _fromSections(false)
+{
+    auto regions = of.sections("__stubs");
+    auto auth = of.sections("__auth_stubs");
+    regions.insert(regions.end(), auth.begin(), auth.end());
+
+    if (regions.size()) {
+        _fromSections = true;
+        for (auto &r : regions)
+            scan(of, r.first, r.second);
+    }else{
+        for (auto &seg : of.segments()) {
+            if (seg.isExec)
+                scan(of, seg.base, seg.size);
+        }
+    }
+}
+
+loc_t jumpstubs::resolve(offsetfinder64 &of, loc_t slot){
+    uint64_t v = 0;
+    try {
+        v = of.deref(slot);
+    } catch (tihmstar::exception &e) {
+        return 0;
+    }
+    if ((v & KERNEL_PTR_TAG) == KERNEL_PTR_TAG && v >= (uint64_t)of.vmBase() && v < (uint64_t)of.vmEnd())
+        return (loc_t)v;
+    return of.pointers().normalize(v); //still encoded, e.g. no chained fixups table
+}
+
+//slot of the stub starting with the adrp at w, 0 if it isn't one
+static uint64_t stubSlot(const uint32_t *w, size_t avail, loc_t loc){
+    if (avail < 3 || (w[0] & 0x1f) != ((w[1] >> 5) & 0x1f))
+        return 0;
+    int64_t page = (int64_t)((((w[0] >> 5) & 0x7FFFF) << 2) | ((w[0] >> 29) & 3));
+    page = (page << 43) >> 43; //sign extend 21 bits
+    uint64_t pagebase = ((uint64_t)loc & ~0xfffULL) + (page << 12);
+
+    if ((w[1] & 0xFFC00000) == 0xF9400000        //ldr x, unsigned offset
+        && (w[2] & 0xFFFFFC1F) == 0xD61F0000     //br
+        && (w[1] & 0x1f) == ((w[2] >> 5) & 0x1f))
+        return pagebase + ((w[1] >> 10) & 0xfff) * 8;
+
+    //arm64e: adrp x17 ; add x17, x17, #off ; ldraa x16, [x17] ; braa x16, x17
+    if (avail < 4
+        || (w[1] & 0xFFC00000) != 0x91000000     //add x, immediate
+        || (w[1] & 0x1f) != ((w[1] >> 5) & 0x1f)
+        || (w[2] & 0xFF200C00) != 0xF8200400     //ldraa/ldrab without writeback
+        || (w[1] & 0x1f) != ((w[2] >> 5) & 0x1f)
+        || ((w[3] & 0xFFFFF800) != 0xD71F0800 && (w[3] & 0xFFFFF81F) != 0xD61F081F) //braa/brab, braaz/brabz
+        || (w[2] & 0x1f) != ((w[3] >> 5) & 0x1f))
+        return 0;
+    int64_t off = (int64_t)((((w[2] >> 22) & 1) << 9) | ((w[2] >> 12) & 0x1ff));
+    off = (off << 54) >> 54; //sign extend 10 bits
+    return pagebase + ((w[1] >> 10) & 0xfff) + off * 8;
+}
+
+void jumpstubs::scan(offsetfinder64 &of, loc_t start, size_t size){
+    static const insnclassdef adrpdef = insnclassdefs[kInsnClassAdrp];
+    const uint32_t *words = (const uint32_t *)of.memoryForLoc(start, size);
+    if (!words)
+        return;
+    size_t n = size / 4;
+    for (size_t blk=0; blk<n; blk+=kClassifyBlockWords) {
+        uint64_t hits = 0;
+        classifyBlock(words+blk, std::min(n-blk, kClassifyBlockWords), &adrpdef, 1, &hits);
+        for (; hits; hits &= hits-1) {
+            size_t k = blk + __builtin_ctzll(hits);
+            loc_t loc = start + 4*k;
+            loc_t slot = (loc_t)stubSlot(words+k, n-k, loc);
+            if (!slot)
+                continue;
+
+            stub s = {loc,slot,resolve(of, slot)};
+            if (_stubs.insert({loc,s}).second && s.target)
+                _byTarget.insert({s.target,loc});
+        }
+    }
+}
+
+const jumpstubs::stub *jumpstubs::find(loc_t loc) const{
+    auto it = _stubs.find(loc);
+    return (it != _stubs.end()) ? &it->second : NULL;
+}
+
+std::vector<loc_t> jumpstubs::stubsTo(loc_t target) const{
+    std::vector<loc_t> ret;
+    auto r = _byTarget.equal_range(target);
+    for (auto it = r.first; it != r.second; ++it)
+        ret.push_back(it->second);
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
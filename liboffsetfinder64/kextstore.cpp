@@ -0,0 +1,152 @@
+//
+//  kextstore.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "kextstore.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/kextstore.hpp>
+#include <liboffsetfinder64/porting.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <atomic>
+#include <set>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+bool kextimage::contains(loc_t loc) const{
+    for (auto &seg : segments) {
+        if (seg.first <= loc && loc < seg.first + seg.second)
+            return true;
+    }
+    return false;
+}
+
+//"G address size" per segment, then "R finder result" per result. false if there is no record
+static bool readRecord(const std::string &path, std::vector<std::pair<loc_t,size_t>> &segments, std::map<std::string,std::string> &results){
+    FILE *f = fopen(path.c_str(), "r");
+    if (!f)
+        return false;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len = 0;
+    while ((len = getline(&line, &cap, f)) > 0) {
+        if (line[len-1] == '\n')
+            line[--len] = '\0';
+        if (line[0] == 'G') {
+            unsigned long long addr = 0, size = 0;
+            if (sscanf(line, "G %llx %llx",&addr,&size) == 2)
+                segments.push_back({(loc_t)addr,(size_t)size});
+        }else if (line[0] == 'R' && line[1] == ' ') {
+            const char *name = line+2;
+            const char *sp = strchr(name, ' ');
+            if (sp)
+                results[std::string(name, sp-name)] = sp+1;
+        }
+    }
+    free(line);
+    fclose(f);
+    return true;
+}
+
+static bool sameLayout(const std::vector<std::pair<loc_t,size_t>> &stored, const kextimage &kext){
+    if (stored.size() != kext.segments.size())
+        return false;
+    for (size_t i=0; i<stored.size(); i++) {
+        if (stored[i].second != kext.segments[i].second)
+            return false;
+    }
+    return true;
+}
+
+kextstore::kextstore(const std::string &dir) :
+    _dir(dir)
+{
+    retassure(!mkdir(_dir.c_str(), 0755) || errno == EEXIST, "failed to create kext store " + _dir);
+}
+
+std::string kextstore::pathFor(const kextimage &kext) const{
+    return _dir + "/" + kext.key + ".kext";
+}
+
+std::map<std::string,std::string> kextstore::reuse(offsetfinder64 &of, uint64_t slide) const{
+    std::map<std::string,std::string> ret;
+    std::set<std::string> conflicts;
+    for (auto &kext : of.kexts()) {
+        std::vector<std::pair<loc_t,size_t>> segments;
+        std::map<std::string,std::string> results;
+        if (!readRecord(pathFor(kext), segments, results) || !sameLayout(segments, kext))
+            continue;
+
+        //segment by segment, the kext may be linked somewhere else now
+        auto relocate = [&](loc_t loc)->loc_t{
+            for (size_t i=0; i<segments.size(); i++) {
+                if (segments[i].first <= loc && loc < segments[i].first + segments[i].second)
+                    return kext.segments[i].first + (loc - segments[i].first);
+            }
+            return 0;
+        };
+        for (auto &r : results) {
+            std::string relocated;
+            if (!relocateResult(r.second, relocate, slide, relocated))
+                continue;
+            auto ins = ret.insert({r.first,relocated});
+            if (!ins.second && ins.first->second != relocated)
+                conflicts.insert(r.first);
+        }
+    }
+    for (auto &c : conflicts)
+        ret.erase(c);
+    return ret;
+}
+
+void kextstore::store(offsetfinder64 &of, const std::map<std::string,std::string> &results, uint64_t slide) const{
+    static std::atomic<unsigned> tmpCounter(0);
+    for (auto &kext : of.kexts()) {
+        auto unslide = [&](loc_t loc)->loc_t{
+            loc -= slide;
+            return kext.contains(loc) ? loc : 0;
+        };
+        std::map<std::string,std::string> own;
+        for (auto &r : results) {
+            std::string unslid;
+            if (relocateResult(r.second, unslide, 0, unslid))
+                own[r.first] = unslid;
+        }
+        if (own.empty())
+            continue;
+
+        //keep what other kernels already stored for this kext
+        std::string path = pathFor(kext);
+        std::vector<std::pair<loc_t,size_t>> segments;
+        std::map<std::string,std::string> stored;
+        if (readRecord(path, segments, stored) && segments.size() == kext.segments.size()) {
+            bool sameAddresses = true;
+            for (size_t i=0; i<segments.size(); i++)
+                sameAddresses &= segments[i] == kext.segments[i];
+            if (sameAddresses)
+                own.insert(stored.begin(), stored.end()); //new results win
+        }
+
+        //write and rename, so concurrent readers never see half a record
+        std::string tmp = path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(tmpCounter++);
+        FILE *f = fopen(tmp.c_str(), "w");
+        if (!f)
+            continue; //the store is only a cache
+        for (auto &seg : kext.segments)
+            fprintf(f, "G %llx %llx\n",(unsigned long long)seg.first,(unsigned long long)seg.second);
+        for (auto &r : own)
+            fprintf(f, "R %s %s\n",r.first.c_str(),r.second.c_str());
+        fclose(f);
+        if (rename(tmp.c_str(), path.c_str()))
+            unlink(tmp.c_str());
+    }
+}
@@ -15,6 +15,7 @@ extern "C"{
 #include <stdio.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <string.h>
 #include "img4.h"
@@ -29,7 +30,10 @@ using namespace patchfinder64;
 #define HAS_BITS(a,b) (((a) & (b)) == (b))
 #define _symtab getSymtab()
 
-#define findstr(str,hasNullTerminator) memmem(str, sizeof(str)-(hasNullTerminator == 0))
+#define findstr(str,hasNullTerminator) findString(str, sizeof(str)-1, hasNullTerminator)
+
+#define SEGMENT_TABLE_PAGE_SHIFT 12
+#define SEGMENT_TABLE_MAX_PAGES (1<<20) //don't build the table for absurdly sparse images
 
 #pragma mark macho external
 
@@ -62,8 +66,49 @@ __attribute__((always_inline)) struct section_64 *find_section(struct segment_co
     return NULL;
 }
 
+#ifndef LC_FILESET_ENTRY
+#   define LC_FILESET_ENTRY (0x35 | LC_REQ_DYLD)
+#endif
+
+struct fileset_entry_raw{
+    uint32_t cmd;
+    uint32_t cmdsize;
+    uint64_t vmaddr;
+    uint64_t fileoff;
+    uint32_t entry_id;
+    uint32_t reserved;
+};
+
+//sections named sectname of mh, and of its fileset entries if it is the kernel header
+static void collect_sections(const uint8_t *kdata, size_t ksize, const struct mach_header_64 *mh, size_t maxsize, const char *sectname, vector<pair<loc_t,size_t>> &out){
+    if (maxsize < sizeof(*mh) || (uint64_t)mh->sizeofcmds + sizeof(*mh) > maxsize)
+        return;
+    const uint8_t *end = (const uint8_t *)(mh + 1) + mh->sizeofcmds;
+    const struct load_command *lcmd = (const struct load_command *)(mh + 1);
+    for (uint32_t i=0; i<mh->ncmds; i++, lcmd = (const struct load_command *)((const uint8_t *)lcmd + lcmd->cmdsize)) {
+        if ((const uint8_t *)(lcmd + 1) > end || lcmd->cmdsize < sizeof(*lcmd) || (const uint8_t *)lcmd + lcmd->cmdsize > end)
+            break;
+        if (lcmd->cmd == LC_SEGMENT_64) {
+            const struct segment_command_64 *seg = (const struct segment_command_64 *)lcmd;
+            const struct section_64 *sect = (const struct section_64 *)(seg + 1);
+            if ((const uint8_t *)(sect + seg->nsects) > (const uint8_t *)lcmd + lcmd->cmdsize)
+                continue;
+            for (uint32_t j=0; j<seg->nsects; j++, sect++) {
+                if (sect->size && strncmp(sect->sectname, sectname, sizeof(sect->sectname)) == 0)
+                    out.push_back({(loc_t)sect->addr,(size_t)sect->size});
+            }
+        }else if (lcmd->cmd == LC_FILESET_ENTRY && (const uint8_t *)mh == kdata) {
+            const fileset_entry_raw *entry = (const fileset_entry_raw *)lcmd;
+            if (entry->fileoff < ksize)
+                collect_sections(kdata, ksize, (const struct mach_header_64 *)(kdata + entry->fileoff), ksize - entry->fileoff, sectname, out);
+        }
+    }
+}
+
 offsetfinder64::offsetfinder64(const char* filename, uint64_t kslide, tristate haveSymbols) :
-        _freeKernel(true),
+        _freeKernel(false),
+        _kmap(NULL),
+        _kmapSize(0),
         __symtab(NULL),
         _kslide(kslide),
         _haveSymtab(haveSymbols)
@@ -71,13 +116,23 @@ offsetfinder64::offsetfinder64(const char* filename, uint64_t kslide, tristate h
     struct stat fs = {0};
     int fd = 0;
     char *img4tmp = NULL;
+    //only called on failure, the destructor doesn't run if the constructor throws
     auto clean =[&]{
         if (fd>0) close(fd);
+        if (_freeKernel) safeFree(_kdata);
+        if (_kmap) munmap(_kmap, _kmapSize);
+        _kmap = NULL;
     };
     assure((fd = open(filename, O_RDONLY)) != -1);
     assureclean(!fstat(fd, &fs));
-    assureclean((_kdata = (uint8_t*)malloc( _ksize = fs.st_size)));
-    assureclean(read(fd,_kdata,_ksize)==_ksize);
+    
+    //map the file instead of reading it, so uncompressed images are only paged in where finders look
+    void *map = mmap(NULL, fs.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    assureclean(map != MAP_FAILED);
+    _kdata = _kmap = (uint8_t*)map;
+    _ksize = _kmapSize = fs.st_size;
+    close(fd); //the mapping stays valid
+    fd = 0;
     
     //check if feedfacf, fat, compressed (lzfse/lzss), img4, im4p
     img4tmp = (char*)_kdata;
@@ -97,8 +152,9 @@ offsetfinder64::offsetfinder64(const char* filename, uint64_t kslide, tristate h
             }
         }
         if (extracted != NULL) {
-            free(_kdata);
+            //the payload is compressed as a whole, so it has to be decompressed up front
             _kdata = (uint8_t*)extracted;
+            _freeKernel = true;
         }
     }
 
@@ -135,17 +191,61 @@ offsetfinder64::offsetfinder64(const char* filename, uint64_t kslide, tristate h
 
         if (tryfat != NULL) {
             printf("got fat macho with first slice at %u\n", (uint32_t) (tryfat - _kdata));
-            free(_kdata);
+            if (_freeKernel) free(_kdata);
             _kdata = tryfat;
+            _freeKernel = true;
         } else {
             printf("got fat macho but failed to parse\n");
         }
     }
     
-    assureclean(*(uint32_t*)_kdata == 0xfeedfacf);
+    uint32_t magic = *(uint32_t*)_kdata; //assureclean evaluates again after clean() unmapped the image
+    assureclean(magic == 0xfeedfacf);
     
-    loadSegments();
-    clean();
+    if (_freeKernel) {
+        //image lives in memory, the file mapping isn't needed anymore
+        munmap(_kmap, _kmapSize);
+        _kmap = NULL;
+        _kmapSize = 0;
+    }
+    
+    try {
+        loadSegments();
+    } catch (...) {
+        clean();
+        throw;
+    }
+    adviseSegments();
+}
+
+void offsetfinder64::adviseSegments(){
+    if (!_kmap)
+        return;
+    //most of a fileset is never looked at, don't read ahead into it
+    madvise(_kmap, _kmapSize, MADV_RANDOM);
+    for (auto &seg : _segments) {
+        if (seg.isExec)
+            adviseSegment(seg, MADV_SEQUENTIAL); //code is scanned linearly
+    }
+}
+
+void offsetfinder64::adviseSegment(const text_t &seg, int advice){
+    if (!_kmap || seg.map < _kmap || seg.map + seg.size > _kmap + _kmapSize)
+        return;
+    size_t pagesize = (size_t)getpagesize();
+    uintptr_t start = (uintptr_t)seg.map & ~(pagesize-1);
+    uintptr_t end = ((uintptr_t)seg.map + seg.size + pagesize-1) & ~(pagesize-1);
+    if (end > (uintptr_t)_kmap + _kmapSize)
+        end = (uintptr_t)_kmap + _kmapSize; //madvise works on whole pages of the mapping only
+    madvise((void*)start, end - start, advice);
+}
+
+void offsetfinder64::releaseSegments(){
+    if (!_kmap)
+        return;
+    //clean file pages, the kernel pages them back in from the file on the next access
+    madvise(_kmap, _kmapSize, MADV_DONTNEED);
+    adviseSegments();
 }
 
 void offsetfinder64::loadSegments(){
@@ -176,6 +276,19 @@ void offsetfinder64::loadSegments(){
         }
     }
     
+    buildSegmentPageTable();
+    
+    try {
+        _fixups = shared_ptr<chainedfixups>(new chainedfixups(*this));
+        if (_fixups->empty())
+            _fixups = NULL;
+        else
+            info("Found %zu rebase chains",_fixups->chainCount());
+    } catch (tihmstar::exception &e) {
+        info("Failed to parse rebase chains, pointers will be read raw: %s",e.what());
+        _fixups = NULL;
+    }
+    
     try {
         deref(_kernel_entry);
         info("Detected non-slid kernel.");
@@ -200,8 +313,39 @@ void offsetfinder64::loadSegments(){
     printf("\n");
 }
 
+void offsetfinder64::buildSegmentPageTable(){
+    _vmBase = (loc_t)UINT64_MAX;
+    _vmEnd = 0;
+    for (auto &seg : _segments) {
+        if (!seg.size) continue;
+        if (seg.base < _vmBase) _vmBase = seg.base;
+        if (seg.base+seg.size > _vmEnd) _vmEnd = seg.base+seg.size;
+    }
+    _segmentPageTable.clear();
+    if (_vmEnd <= _vmBase)
+        return;
+    
+    uint64_t pages = ((_vmEnd - _vmBase) >> SEGMENT_TABLE_PAGE_SHIFT) + 1;
+    if (pages > SEGMENT_TABLE_MAX_PAGES || _segments.size() >= UINT16_MAX){
+        info("Not building segment page table, falling back to linear segment lookup");
+        return;
+    }
+    _segmentPageTable.resize(pages,0);
+    for (uint16_t i=0; i<_segments.size(); i++) {
+        auto &seg = _segments[i];
+        if (!seg.size) continue;
+        uint64_t first = (seg.base - _vmBase) >> SEGMENT_TABLE_PAGE_SHIFT;
+        uint64_t last = (seg.base + seg.size - 1 - _vmBase) >> SEGMENT_TABLE_PAGE_SHIFT;
+        for (uint64_t p = first; p<=last; p++) {
+            if (!_segmentPageTable[p]) _segmentPageTable[p] = i+1;
+        }
+    }
+}
+
 offsetfinder64::offsetfinder64(void* buf, size_t size, uint64_t kslide, tristate haveSymbols) :
         _freeKernel(false),
+        _kmap(NULL),
+        _kmapSize(0),
         _kdata((uint8_t*)buf),
         _ksize(size),
         __symtab(NULL),
@@ -224,33 +368,185 @@ loc_t offsetfinder64::find_base(){
 }
 
 bool offsetfinder64::haveSymbols(){
-    if (_haveSymtab == kuninitialized) {
+    return haveSymtab() || _symbols;
+}
+
+void offsetfinder64::useSymbols(std::shared_ptr<const symbolmap> symbols){
+    _symbols = symbols;
+}
+
+bool offsetfinder64::haveSymtab(){
+    std::call_once(_haveSymtabOnce, [this]{
+        if (_haveSymtab != kuninitialized)
+            return;
         try {
             getSymtab();
             _haveSymtab = ktrue;
         } catch (tihmstar::symtab_not_found &e) {
             _haveSymtab = kfalse;
         }
-    }
+    });
     return _haveSymtab;
 }
 
+static std::string uuid_string(const uint8_t *u){
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%02X%02X%02X%02X-%02X%02X-%02X%02X-%02X%02X-%02X%02X%02X%02X%02X%02X",
+             u[0],u[1],u[2],u[3],u[4],u[5],u[6],u[7],u[8],u[9],u[10],u[11],u[12],u[13],u[14],u[15]);
+    return buf;
+}
+
+std::string offsetfinder64::uuid(){
+    struct uuid_command *cmd = NULL;
+    try {
+        cmd = (struct uuid_command *)find_load_command64((struct mach_header_64 *)_kdata, LC_UUID);
+    } catch (tihmstar::load_command_not_found &e) {
+        return "";
+    }
+    return uuid_string(cmd->uuid);
+}
+
+//segments and key of a single image, false if it has no segments
+static bool parse_kext_image(offsetfinder64 &of, const struct mach_header_64 *mh, size_t maxsize, bool skipPrelinked, kextimage &out){
+    if (maxsize < sizeof(*mh) || (uint64_t)mh->sizeofcmds + sizeof(*mh) > maxsize)
+        return false;
+    const uint8_t *end = (const uint8_t *)(mh + 1) + mh->sizeofcmds;
+    const struct load_command *lcmd = (const struct load_command *)(mh + 1);
+    for (uint32_t i=0; i<mh->ncmds; i++, lcmd = (const struct load_command *)((const uint8_t *)lcmd + lcmd->cmdsize)) {
+        if ((const uint8_t *)(lcmd + 1) > end || lcmd->cmdsize < sizeof(*lcmd) || (const uint8_t *)lcmd + lcmd->cmdsize > end)
+            break;
+        if (lcmd->cmd == LC_SEGMENT_64) {
+            const struct segment_command_64 *seg = (const struct segment_command_64 *)lcmd;
+            if (!seg->vmsize || strncmp(seg->segname, "__LINKEDIT", sizeof(seg->segname)) == 0)
+                continue;
+            if (skipPrelinked && (strncmp(seg->segname, "__PRELINK", 9) == 0 || strncmp(seg->segname, "__PLK", 5) == 0))
+                continue; //kexts of a prelinked kernelcache are images of their own
+            out.segments.push_back({(loc_t)seg->vmaddr,(size_t)seg->vmsize});
+        }else if (lcmd->cmd == LC_UUID && lcmd->cmdsize >= sizeof(struct uuid_command)) {
+            out.key = uuid_string(((const struct uuid_command *)lcmd)->uuid);
+        }
+    }
+    if (out.key.empty()) {
+        //FNV-1a over the segment contents
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (auto &seg : out.segments) {
+            const uint8_t *mem = (const uint8_t *)of.memoryForLoc(seg.first, seg.second);
+            for (size_t i=0; mem && i<seg.second; i++)
+                h = (h ^ mem[i]) * 0x100000001b3ULL;
+            h = (h ^ seg.second) * 0x100000001b3ULL;
+        }
+        char buf[0x20];
+        snprintf(buf, sizeof(buf), "%016llx",(unsigned long long)h);
+        out.key = buf;
+    }
+    return out.segments.size();
+}
+
+const vector<kextimage> &offsetfinder64::kexts(){
+    std::call_once(_kextsOnce, [this]{
+        struct mach_header_64 *mh = (struct mach_header_64 *)_kdata;
+        struct load_command *lcmd = (struct load_command *)(mh + 1);
+        bool isFileset = false;
+        for (uint32_t i=0; i<mh->ncmds; i++, lcmd = (struct load_command *)((uint8_t *)lcmd + lcmd->cmdsize)) {
+            if (lcmd->cmd != LC_FILESET_ENTRY)
+                continue;
+            const fileset_entry_raw *entry = (const fileset_entry_raw *)lcmd;
+            isFileset = true;
+            kextimage kext;
+            if (entry->entry_id < entry->cmdsize)
+                kext.name = string((const char *)entry + entry->entry_id, strnlen((const char *)entry + entry->entry_id, entry->cmdsize - entry->entry_id));
+            if (entry->fileoff < _ksize && parse_kext_image(*this, (const struct mach_header_64 *)(_kdata + entry->fileoff), _ksize - entry->fileoff, false, kext))
+                _kexts.push_back(kext);
+        }
+        if (isFileset)
+            return;
+        
+        //prelinked kernelcache, the kernel and every kext header on a page in __PRELINK_TEXT
+        kextimage kernel;
+        kernel.name = "com.apple.kernel";
+        if (parse_kext_image(*this, mh, _ksize, true, kernel))
+            _kexts.push_back(kernel);
+        lcmd = (struct load_command *)(mh + 1);
+        for (uint32_t i=0; i<mh->ncmds; i++, lcmd = (struct load_command *)((uint8_t *)lcmd + lcmd->cmdsize)) {
+            struct segment_command_64 *seg = (struct segment_command_64 *)lcmd;
+            if (lcmd->cmd != LC_SEGMENT_64 || strncmp(seg->segname, "__PRELINK_TEXT", sizeof(seg->segname)) != 0)
+                continue;
+            if ((uint64_t)seg->fileoff + seg->filesize > _ksize)
+                continue;
+            for (uint64_t off=0; off+sizeof(struct mach_header_64) <= seg->filesize; off+=0x1000) {
+                const struct mach_header_64 *kext = (const struct mach_header_64 *)(_kdata + seg->fileoff + off);
+                kextimage img;
+                if (kext->magic == MH_MAGIC_64 && kext->filetype == MH_KEXT_BUNDLE && parse_kext_image(*this, kext, seg->filesize - off, false, img))
+                    _kexts.push_back(img);
+            }
+        }
+    });
+    return _kexts;
+}
+
+vector<pair<loc_t,size_t>> offsetfinder64::sections(const char *sectname){
+    vector<pair<loc_t,size_t>> ret;
+    collect_sections(_kdata, _ksize, (struct mach_header_64 *)_kdata, _ksize, sectname, ret);
+    
+    //prelinked kexts, every kext header starts on a page in __PRELINK_TEXT
+    struct mach_header_64 *mh = (struct mach_header_64 *)_kdata;
+    struct load_command *lcmd = (struct load_command *)(mh + 1);
+    for (uint32_t i=0; i<mh->ncmds; i++, lcmd = (struct load_command *)((uint8_t *)lcmd + lcmd->cmdsize)) {
+        struct segment_command_64 *seg = (struct segment_command_64 *)lcmd;
+        if (lcmd->cmd != LC_SEGMENT_64 || strncmp(seg->segname, "__PRELINK_TEXT", sizeof(seg->segname)) != 0)
+            continue;
+        if ((uint64_t)seg->fileoff + seg->filesize > _ksize)
+            continue;
+        for (uint64_t off=0; off+sizeof(struct mach_header_64) <= seg->filesize; off+=0x1000) {
+            const struct mach_header_64 *kext = (const struct mach_header_64 *)(_kdata + seg->fileoff + off);
+            if (kext->magic == MH_MAGIC_64 && kext->filetype == MH_KEXT_BUNDLE)
+                collect_sections(_kdata, _ksize, kext, seg->filesize - off, sectname, ret);
+        }
+    }
+    return ret;
+}
+
 #pragma mark macho offsetfinder
 __attribute__((always_inline)) struct symtab_command *offsetfinder64::getSymtab(){
-    if (!__symtab){
+    std::call_once(_symtabOnce, [this]{
         try {
             __symtab = find_symtab_command((struct mach_header_64 *)_kdata);
         } catch (tihmstar::load_command_not_found &e) {
-            if (e.cmd() != LC_SYMTAB)
-                throw;
-            retcustomerror("symtab not found. Is this a dumped kernel?", symtab_not_found);
+            __symtab = NULL;
         }
-    }
+    });
+    if (!__symtab)
+        retcustomerror("symtab not found. Is this a dumped kernel?", symtab_not_found);
     return __symtab;
 }
 
 #pragma mark offsetfidner
 
+const text_t *offsetfinder64::segmentForLoc(loc_t pos){
+    if (_segmentPageTable.size()) {
+        if (pos < _vmBase || pos >= _vmEnd)
+            return NULL;
+        if (uint16_t i = _segmentPageTable[(pos - _vmBase) >> SEGMENT_TABLE_PAGE_SHIFT]) {
+            const text_t *seg = &_segments[i-1];
+            if (seg->base <= pos && pos < seg->base+seg->size)
+                return seg;
+        }
+        //page shared by two segments which aren't page aligned, fall through
+    }
+    for (auto &seg : _segments) {
+        if (seg.base <= pos && pos < seg.base+seg.size)
+            return &seg;
+    }
+    return NULL;
+}
+
+offset_t offsetfinder64::fileOffsetForLoc(loc_t pos){
+    const text_t *seg = segmentForLoc(pos);
+    if (!seg)
+        throw tihmstar::out_of_range("fileOffsetForLoc: location not in any segment");
+    return (offset_t)(seg->map - _kdata) + (pos - seg->base);
+}
+
 loc_t offsetfinder64::memmem(const void *little, size_t little_len){
     for (auto seg : _segments) {
         if (loc_t rt = (loc_t)::memmem(seg.map, seg.size, little, little_len)) {
@@ -260,11 +556,45 @@ loc_t offsetfinder64::memmem(const void *little, size_t little_len){
     return 0;
 }
 
+loc_t offsetfinder64::findString(const char *str, size_t len, bool hasNullTerminator){
+    cstringindex &strs = cstrings();
+    if (hasNullTerminator && !::memchr(str, 0, len)) {
+        if (loc_t rt = strs.find(str, len))
+            return rt;
+    }
+    //prefixes, substrings and strings outside of the string sections
+    size_t little_len = len + (hasNullTerminator ? 1 : 0);
+    if (loc_t rt = strs.search(str, little_len))
+        return rt;
+    return memmem(str, little_len);
+}
+
+const void *offsetfinder64::memoryForLoc(loc_t pos, size_t size){
+    const text_t *seg = segmentForLoc(pos);
+    if (!seg || pos + size > seg->base + seg->size)
+        return NULL;
+    return seg->map + (pos - seg->base);
+}
+
+const void *offsetfinder64::rebasedMemoryForLoc(loc_t pos, size_t size){
+    if (!_fixups)
+        return memoryForLoc(pos, size);
+    return _fixups->rebasedMemoryForLoc(pos, size);
+}
+
 uint64_t offsetfinder64::deref(loc_t pos){
-    return insn::deref(_segments,pos);
+    const void *mem = rebasedMemoryForLoc(pos, sizeof(uint64_t));
+    if (!mem)
+        throw tihmstar::out_of_range("deref: location not in any segment");
+    return *(uint64_t*)mem;
 }
 
 loc_t offsetfinder64::find_sym(const char *sym){
+    if (_symbols && !haveSymtab()) {
+        if (loc_t rt = _symbols->find(sym))
+            return rt;
+        retcustomerror("Failed to find symbol "+string(sym),symbol_not_found);
+    }
     uint8_t *psymtab = _kdata + _symtab->symoff;
     uint8_t *pstrtab = _kdata + _symtab->stroff;
 
@@ -277,10 +607,56 @@ loc_t offsetfinder64::find_sym(const char *sym){
     return 0;
 }
 
+loc_t offsetfinder64::lookup_sym(const char *sym){
+    if (!haveSymbols())
+        return 0;
+    try {
+        return find_sym(sym);
+    } catch (tihmstar::symbol_not_found &e) {
+        return 0;
+    }
+}
+
+vector<pair<const char *,loc_t>> offsetfinder64::find_syms_with_prefix(const char *prefix){
+    if (_symbols && !haveSymtab())
+        return _symbols->withPrefix(prefix);
+    retassure(haveSymtab(), "no symtab");
+    vector<pair<const char *,loc_t>> ret;
+    uint8_t *psymtab = _kdata + _symtab->symoff;
+    uint8_t *pstrtab = _kdata + _symtab->stroff;
+    size_t prefixlen = strlen(prefix);
+    
+    struct nlist_64 *entry = (struct nlist_64 *)psymtab;
+    for (uint32_t i = 0; i < _symtab->nsyms; i++, entry++){
+        const char *name = (char*)(pstrtab + entry->n_un.n_strx);
+        if (!strncmp(name, prefix, prefixlen))
+            ret.push_back({name,(loc_t)entry->n_value});
+    }
+    return ret;
+}
+
+const char *offsetfinder64::find_sym_name(loc_t addr){
+    if (!haveSymtab())
+        return _symbols ? _symbols->nameFor(addr) : NULL;
+    std::call_once(_symbolsByAddrOnce, [this]{
+        uint8_t *psymtab = _kdata + _symtab->symoff;
+        uint8_t *pstrtab = _kdata + _symtab->stroff;
+        
+        struct nlist_64 *entry = (struct nlist_64 *)psymtab;
+        _symbolsByAddr.reserve(_symtab->nsyms);
+        for (uint32_t i = 0; i < _symtab->nsyms; i++, entry++){
+            if (entry->n_type & N_STAB || !entry->n_value)
+                continue;
+            _symbolsByAddr.insert({entry->n_value,(char*)(pstrtab + entry->n_un.n_strx)}); //first one wins
+        }
+    });
+    auto it = _symbolsByAddr.find((uint64_t)addr);
+    return (it != _symbolsByAddr.end()) ? it->second : NULL;
+}
+
 loc_t offsetfinder64::find_syscall0(){
-    constexpr char sig_syscall_3[] = "\x06\x00\x00\x00\x03\x00\x0c\x00";
-    loc_t sys3 = memmem(sig_syscall_3, sizeof(sig_syscall_3)-1);
-    return sys3 - (3 * 0x18) + 0x8;
+    //this has always pointed one entry past sysent[0], callers index from there
+    return syscalls().sysentLocation() + syscalls().sysentStride();
 }
 
 
@@ -289,23 +665,14 @@ loc_t offsetfinder64::find_syscall0(){
 namespace tihmstar{
     namespace patchfinder64{
         
-        loc_t jump_stub_call_ptr_loc(insn bl_insn){
-            assure(bl_insn == insn::bl);
-            insn fdst(bl_insn,(loc_t)bl_insn.imm());
-            insn ldr((fdst+1));
-            if (!((fdst == insn::adrp && ldr == insn::ldr && (fdst+2) == insn::br))) {
-                retcustomerror("branch destination not jump_stub_call", bad_branch_destination);
-            }
-            return (loc_t)fdst.imm() + ldr.imm();
-        }
-        
-        bool is_call_to_jump_stub(insn bl_insn){
-            try {
-                jump_stub_call_ptr_loc(bl_insn);
-                return true;
-            } catch (tihmstar::bad_branch_destination &e) {
-                return false;
+        //first call after pos through a jump stub resolving to target, NULL if there is none
+        const callgraph::call *first_stub_call_to(offsetfinder64 &of, loc_t target, loc_t pos){
+            callgraph::range calls = of.callGraph().callersOf(target);
+            for (const callgraph::call *c = calls.first; c != calls.second; c++) {
+                if (c->site > pos && c->target != c->callee)
+                    return c;
             }
+            return NULL;
         }
         
     }
@@ -354,6 +721,105 @@ uint64_t offsetfinder64::find_register_value(loc_t where, int reg, loc_t startAd
     return value[reg];
 }
 
+#define FUNCTION_MAX_INSNS 0x4000
+
+pair<loc_t,loc_t> offsetfinder64::functionBounds(loc_t where){
+    insn functop(_segments, where);
+    
+    //same prologue heuristic as find_register_value
+    if (functop != insn::stp || (functop+1) != insn::stp || (functop+2) != insn::stp)
+        while (--functop != insn::stp || (functop+1) != insn::stp || (functop+2) != insn::stp);
+    
+    //function ends at a ret/b followed by the next functions prologue
+    insn funcend(functop);
+    try {
+        for (int i=0; i<FUNCTION_MAX_INSNS; i++) {
+            enum insn::type t = (++funcend).type();
+            if ((t == insn::ret || t == insn::b) && (loc_t)funcend.pc() >= where && (funcend+1) == insn::stp){
+                ++funcend;
+                break;
+            }
+        }
+    } catch (tihmstar::out_of_range &e) {
+        //end of segment
+        return {(loc_t)functop.pc(),(loc_t)funcend.pc()+4};
+    }
+    return {(loc_t)functop.pc(),(loc_t)funcend.pc()};
+}
+
+cfg &offsetfinder64::functionCfg(loc_t where){
+    {
+        std::unique_lock<std::mutex> l(_functionCacheLock);
+        auto it = _cfgs.upper_bound(where);
+        if (it != _cfgs.begin()) {
+            --it;
+            if (where < it->second->end())
+                return *it->second;
+        }
+    }
+    auto bounds = functionBounds(where);
+    shared_ptr<cfg> g(new cfg(*this, bounds.first, bounds.second));
+    
+    std::unique_lock<std::mutex> l(_functionCacheLock);
+    auto ins = _cfgs.insert({bounds.first,g}); //if another thread was faster, use its graph
+    return *ins.first->second;
+}
+
+vtablecache &offsetfinder64::vtables(){
+    return _vtables.get(*this);
+}
+
+migtable &offsetfinder64::mig(){
+    return _mig.get(*this);
+}
+
+syscalltable &offsetfinder64::syscalls(){
+    return _syscalls.get(*this);
+}
+
+ofvariabletable &offsetfinder64::ofvariables(){
+    return _ofvariables.get(*this);
+}
+
+pointerindex &offsetfinder64::pointers(){
+    return _pointers.get(*this);
+}
+
+insnindex &offsetfinder64::insnIndex(){
+    return _insnIndex.get(*this);
+}
+
+callgraph &offsetfinder64::callGraph(){
+    return _callGraph.get(*this);
+}
+
+jumpstubs &offsetfinder64::jumpStubs(){
+    return _jumpStubs.get(*this);
+}
+
+cstringindex &offsetfinder64::cstrings(){
+    return _cstrings.get(*this);
+}
+
+fingerprints &offsetfinder64::functionPrints(){
+    return _functionPrints.get(*this);
+}
+
+regtracker &offsetfinder64::functionRegtracker(loc_t where){
+    cfg &g = functionCfg(where);
+    {
+        std::unique_lock<std::mutex> l(_functionCacheLock);
+        auto it = _regtrackers.find(g.start());
+        if (it != _regtrackers.end())
+            return *it->second;
+    }
+    shared_ptr<regtracker> rt(new regtracker(*this, g));
+    
+    std::unique_lock<std::mutex> l(_functionCacheLock);
+    auto ins = _regtrackers.insert({g.start(),rt});
+    return *ins.first->second;
+}
+
 #pragma mark v0rtex
 loc_t offsetfinder64::find_zone_map(){
     loc_t str = findstr("zone_init",true);
@@ -366,10 +832,10 @@ loc_t offsetfinder64::find_zone_map(){
     
     loc_t ret = 0;
     
-    while (++ptr != insn::adrp);
+    ptr.nextOf(insn::adrp, insnIndex());
     ret = (loc_t)ptr.imm();
     
-    while (++ptr != insn::add);
+    ptr.nextOf(insn::add, insnIndex());
     ret += ptr.imm();
     
     return ret;
@@ -390,10 +856,10 @@ loc_t offsetfinder64::find_realhost(){
     
     loc_t ret = 0;
     
-    while (++ptr != insn::adrp);
+    ptr.nextOf(insn::adrp, insnIndex());
     ret = (loc_t)ptr.imm();
     
-    while (++ptr != insn::add);
+    ptr.nextOf(insn::add, insnIndex());
     ret += ptr.imm();
     
     return ret;
@@ -417,32 +883,26 @@ loc_t offsetfinder64::find_copyin(){
 
 loc_t offsetfinder64::find_ipc_port_alloc_special(){
     loc_t sym = find_sym("_KUNCGetNotificationID");
-    insn ptr(_segments,sym);
+    const callgraph::call *bl = callGraph().nthCallAfter(sym, 2);
+    retassure(bl, "Failed to find second call in KUNCGetNotificationID");
     
-    while (++ptr != insn::bl);
-    while (++ptr != insn::bl);
-    
-    return (loc_t)ptr.imm();
+    return bl->target;
 }
 
 loc_t offsetfinder64::find_ipc_kobject_set(){
     loc_t sym = find_sym("_KUNCGetNotificationID");
-    insn ptr(_segments,sym);
+    const callgraph::call *bl = callGraph().nthCallAfter(sym, 3);
+    retassure(bl, "Failed to find third call in KUNCGetNotificationID");
     
-    while (++ptr != insn::bl);
-    while (++ptr != insn::bl);
-    while (++ptr != insn::bl);
-    
-    return (loc_t)ptr.imm();
+    return bl->target;
 }
 
 loc_t offsetfinder64::find_ipc_port_make_send(){
     loc_t sym = find_sym("_convert_task_to_port");
-    insn ptr(_segments,sym);
-    while (++ptr != insn::bl);
-    while (++ptr != insn::bl);
+    const callgraph::call *bl = callGraph().nthCallAfter(sym, 2);
+    retassure(bl, "Failed to find second call in convert_task_to_port");
     
-    return (loc_t)ptr.imm();
+    return bl->target;
 }
 
 loc_t offsetfinder64::find_chgproccnt(){
@@ -454,7 +914,7 @@ loc_t offsetfinder64::find_chgproccnt(){
     
     insn functop(_segments,ref);
     
-    while (--functop != insn::stp);
+    functop.prevOf(insn::stp, insnIndex());
     while (--functop == insn::stp);
     ++functop;
     
@@ -470,35 +930,15 @@ loc_t offsetfinder64::find_osserializer_serialize(){
 }
 
 uint32_t offsetfinder64::find_vtab_get_external_trap_for_index(){
-    loc_t sym = find_sym("__ZTV12IOUserClient");
-    sym += 2*sizeof(uint64_t);
-    
     loc_t nn = find_sym("__ZN12IOUserClient23getExternalTrapForIndexEj");
-    
-    insn data(_segments,sym,insn::kText_and_Data);
-    --data;
-    for (int i=0; i<0x200; i++) {
-        if ((++data).doublevalue() == (uint64_t)nn)
-            return i;
-        ++data;
-    }
-    return 0;
+    int32_t slot = vtables().slotOf("IOUserClient", nn);
+    return (slot < 0) ? 0 : slot;
 }
 
 uint32_t offsetfinder64::find_vtab_get_retain_count(){
-    loc_t sym = find_sym("__ZTV12IOUserClient");
-    sym += 2*sizeof(uint64_t);
-    
     loc_t nn = find_sym("__ZNK8OSObject14getRetainCountEv");
-    
-    insn data(_segments,sym,insn::kText_and_Data);
-    --data;
-    for (int i=0; i<0x200; i++) {
-        if ((++data).doublevalue() == (uint64_t)nn)
-            return i;
-        ++data;
-    }
-    return 0;
+    int32_t slot = vtables().slotOf("IOUserClient", nn);
+    return (slot < 0) ? 0 : slot;
 }
 
 uint32_t offsetfinder64::find_proc_ucred(){
@@ -516,7 +956,7 @@ uint32_t offsetfinder64::find_vm_map_hdr(){
     
     insn stp(_segments, sym);
     
-    while (++stp != insn::bl);
+    stp.nextOf(insn::bl, insnIndex());
 
     while (++stp != insn::cbz && stp != insn::cbnz);
     
@@ -525,23 +965,18 @@ uint32_t offsetfinder64::find_vm_map_hdr(){
     return (uint32_t)stp.imm();
 }
 
-typedef struct mig_subsystem_struct {
-    uint32_t min;
-    uint32_t max;
-    char *names;
-} mig_subsys;
+#define MIG_TASK_SUBSYSTEM 3400
+#define MIG_MACH_PORTS_REGISTER (MIG_TASK_SUBSYSTEM+3)
+#define MACH_TRAP_IOKIT_USER_CLIENT 100
 
-mig_subsys task_subsys ={ 0xd48, 0xd7a , NULL};
 uint32_t offsetfinder64::find_task_itk_self(){
-    loc_t task_subsystem=memmem(&task_subsys, 4);
-    assure(task_subsystem);
-    task_subsystem += 4*sizeof(uint64_t); //index0 now
+    loc_t stub = mig().routine(MIG_MACH_PORTS_REGISTER).stub_routine;
+    retassure(stub, "mach_ports_register has no stub routine");
     
-    insn mach_ports_register(_segments, (loc_t)insn::deref(_segments, task_subsystem+3*5*8));
+    const callgraph::call *lock = callGraph().firstCallTo(find_sym("_lck_mtx_lock"), stub);
+    retassure(lock, "Failed to find call to lck_mtx_lock");
     
-    while (++mach_ports_register != insn::bl || mach_ports_register.imm() != (uint64_t)find_sym("_lck_mtx_lock"));
-    
-    insn ldr(mach_ports_register);
+    insn ldr(_segments, lock->site);
     
     while (++ldr != insn::ldr || (ldr+1) != insn::cbz);
     
@@ -549,55 +984,27 @@ uint32_t offsetfinder64::find_task_itk_self(){
 }
 
 uint32_t offsetfinder64::find_task_itk_registered(){
-    loc_t task_subsystem=memmem(&task_subsys, 4);
-    assure(task_subsystem);
-    task_subsystem += 4*sizeof(uint64_t); //index0 now
-    
-    insn mach_ports_register(_segments, (loc_t)insn::deref(_segments, task_subsystem+3*5*8));
+    loc_t stub = mig().routine(MIG_MACH_PORTS_REGISTER).stub_routine;
+    retassure(stub, "mach_ports_register has no stub routine");
     
-    while (++mach_ports_register != insn::bl || mach_ports_register.imm() != (uint64_t)find_sym("_lck_mtx_lock"));
+    const callgraph::call *lock = callGraph().firstCallTo(find_sym("_lck_mtx_lock"), stub);
+    retassure(lock, "Failed to find call to lck_mtx_lock");
     
-    insn ldr(mach_ports_register);
+    insn ldr(_segments, lock->site);
     
     while (++ldr != insn::ldr || (ldr+1) != insn::cbz);
-    while (++ldr != insn::ldr);
+    ldr.nextOf(insn::ldr, insnIndex());
     
     return (uint32_t)ldr.imm();
 }
 
 
 //IOUSERCLIENT_IPC
-mig_subsys host_priv_subsys = { 400, 426 } ;
 uint32_t offsetfinder64::find_iouserclient_ipc(){
-    loc_t host_priv_subsystem=memmem(&host_priv_subsys, 8);
-    assure(host_priv_subsystem);
-
-    insn memiterator(_segments,host_priv_subsystem,insn::kData_only);
-    loc_t thetable = 0;
-    while (1){
-        --memiterator;--memiterator; //dec 8 byte
-        struct _anon{
-            uint64_t ptr;
-            uint64_t z0;
-            uint64_t z1;
-            uint64_t z2;
-        } *obj = (struct _anon*)(void*)memiterator;
-        
-        if (!obj->z0 && !obj->z1 &&
-            !memcmp(&obj[0], &obj[1], sizeof(struct _anon)) &&
-            !memcmp(&obj[0], &obj[2], sizeof(struct _anon)) &&
-            !memcmp(&obj[0], &obj[3], sizeof(struct _anon)) &&
-            !memcmp(&obj[0], &obj[4], sizeof(struct _anon)) &&
-            !obj[-1].ptr && obj[-1].z0 == 1 && !obj[-1].z1) {
-            thetable = (loc_t)memiterator.pc();
-            break;
-        }
-    }
-    
-    loc_t iokit_user_client_trap_func = (loc_t)insn::deref(_segments, thetable + 100*4*8 - 8);
+    loc_t iokit_user_client_trap_func = syscalls().machTrap(MACH_TRAP_IOKIT_USER_CLIENT).handler;
     
     insn bl_to_iokit_add_connect_reference(_segments,iokit_user_client_trap_func);
-    while (++bl_to_iokit_add_connect_reference != insn::bl);
+    bl_to_iokit_add_connect_reference.nextOf(insn::bl, insnIndex());
     
     insn iokit_add_connect_reference(bl_to_iokit_add_connect_reference,(loc_t)bl_to_iokit_add_connect_reference.imm());
     
@@ -615,7 +1022,7 @@ uint32_t offsetfinder64::find_ipc_space_is_task_11(){
     
     insn istr(_segments,ref);
 
-    while (--istr != insn::str);
+    istr.prevOf(insn::str, insnIndex());
 
     return (uint32_t)istr.imm();
 }
@@ -651,9 +1058,9 @@ uint32_t offsetfinder64::find_ipc_space_is_task(){
     insn istr(_segments,bref);
     
     if (!do_backup_plan) {
-        while (++istr != insn::str);
+        istr.nextOf(insn::str, insnIndex());
     }else{
-        while (--istr != insn::str);
+        istr.prevOf(insn::str, insnIndex());
     }
 
     return (uint32_t)istr.imm();
@@ -691,33 +1098,13 @@ uint32_t offsetfinder64::find_sizeof_task(){
 }
 
 loc_t offsetfinder64::find_rop_add_x0_x0_0x10(){
-    constexpr char ropbytes[] = "\x00\x40\x00\x91\xC0\x03\x5F\xD6";
-    return [](const void *little, size_t little_len, vector<text_t>segments)->loc_t{
-        for (auto seg : segments) {
-            if (!seg.isExec)
-                continue;
-            
-            if (loc_t rt = (loc_t)::memmem(seg.map, seg.size, little, little_len)) {
-                return rt-seg.map+seg.base;
-            }
-        }
-        return 0;
-    }(ropbytes,sizeof(ropbytes)-1,_segments);
+    static const pattern gadget("add x0, x0, #0x10 ; ret");
+    return find_exec(gadget);
 }
 
 loc_t offsetfinder64::find_rop_ldr_x0_x0_0x10(){
-    constexpr char ropbytes[] = "\x00\x08\x40\xF9\xC0\x03\x5F\xD6";
-    return [](const void *little, size_t little_len, vector<text_t>segments)->loc_t{
-        for (auto seg : segments) {
-            if (!seg.isExec)
-                continue;
-            
-            if (loc_t rt = (loc_t)::memmem(seg.map, seg.size, little, little_len)) {
-                return rt-seg.map+seg.base;
-            }
-        }
-        return 0;
-    }(ropbytes,sizeof(ropbytes)-1,_segments);
+    static const pattern gadget("ldr x0, [x0, #0x10] ; ret");
+    return find_exec(gadget);
 }
 
 loc_t offsetfinder64::find_exec(std::function<bool(patchfinder64::insn &i)>cmpfunc){
@@ -734,6 +1121,12 @@ loc_t offsetfinder64::find_exec(std::function<bool(patchfinder64::insn &i)>cmpfu
     return 0;
 }
 
+loc_t offsetfinder64::find_exec(const pattern &p){
+    patternset set;
+    set.add(p);
+    return set.first(*this).front();
+}
+
 
 
 #pragma mark patch_finders
@@ -770,10 +1163,10 @@ patch offsetfinder64::find_amfi_substrate_patch(){
     retassure(ref, "literal ref to str");
 
     insn funcend(_segments, ref);
-    while (++funcend != insn::ret);
+    funcend.nextOf(insn::ret, insnIndex());
     
     insn tbnz(funcend);
-    while (--tbnz != insn::tbnz);
+    tbnz.prevOf(insn::tbnz, insnIndex());
     
     constexpr char mypatch[] = "\x1F\x20\x03\xD5\x08\x79\x16\x12\x1F\x20\x03\xD5\x00\x00\x80\x52\xE9\x01\x80\x52";
     return {(loc_t)tbnz.pc(),mypatch,sizeof(mypatch)-1};
@@ -786,11 +1179,22 @@ patch offsetfinder64::find_cs_enforcement_disable_amfi(){
     loc_t ref = find_literal_ref(_segments, str);
     retassure(ref, "literal ref to str");
 
-    insn cbz(_segments, ref);
-    while (--cbz != insn::cbz);
+    //the cbz skipping the csflags log is the condition the block of ref depends on
+    loc_t cond = 0;
+    try {
+        cond = functionCfg(ref).dominatingCondition(ref);
+    } catch (tihmstar::exception &e) {
+        //function bounds heuristic failed
+    }
+    if (!cond || insn(_segments, cond) != insn::cbz) {
+        insn prev(_segments, ref);
+        prev.prevOf(insn::cbz, insnIndex());
+        cond = (loc_t)prev.pc();
+    }
+    insn cbz(_segments, cond);
     
     insn movz(cbz);
-    while (++movz != insn::movz);
+    movz.nextOf(insn::movz, insnIndex());
     --movz;
 
     int anz = static_cast<int>((movz.pc()-cbz.pc())/4 +1);
@@ -824,20 +1228,21 @@ patch offsetfinder64::find_amfi_patch_offsets(){
     loc_t memcmp = 0;
     
     loc_t jscpl = 0;
-    while (1) {
-        while (++bl_amfi_memcp != insn::bl);
-        
-        try {
-            jscpl = jump_stub_call_ptr_loc(bl_amfi_memcp);
-        } catch (tihmstar::bad_branch_destination &e) {
-            continue;
-        }
-        if (haveSymbols()) {
-            if (insn::deref(_segments, jscpl) == (uint64_t)(memcmp = find_sym("_memcmp")))
-                break;
-        }else{
+    if ((memcmp = lookup_sym("_memcmp"))) {
+        const callgraph::call *bl = first_stub_call_to(*this, memcmp, ref);
+        retassure(bl, "Failed to find call to memcmp stub");
+        jscpl = jumpStubs().find(bl->target)->slot;
+    }else{
+        while (1) {
+            bl_amfi_memcp.nextOf(insn::bl, insnIndex());
+            
+            const jumpstubs::stub *stub = jumpStubs().find((loc_t)bl_amfi_memcp.imm());
+            if (!stub || !stub->target)
+                continue;
+            jscpl = stub->slot;
+            
             //check for _memcmp function signature
-            insn checker(_segments, memcmp = (loc_t)insn::deref(_segments, jscpl));
+            insn checker(_segments, memcmp = stub->target);
             if (checker == insn::cbz
                 && (++checker == insn::ldrb && checker.rn() == 0)
                 && (++checker == insn::ldrb && checker.rn() == 1)
@@ -846,7 +1251,6 @@ patch offsetfinder64::find_amfi_patch_offsets(){
                 break;
             }
         }
-        
     }
     
     /* find*/
@@ -867,12 +1271,12 @@ patch offsetfinder64::find_proc_enforce(){
     loc_t str = findstr("Enforce MAC policy on process operations", false);
     retassure(str, "Failed to find str");
     
-    loc_t valref = memmem(&str, sizeof(str));
+    loc_t valref = pointers().firstRefTo(str);
     retassure(valref, "Failed to find val ref");
     
     loc_t proc_enforce_ptr = valref - (5 * sizeof(uint64_t));
     
-    loc_t proc_enforce_val_loc = (loc_t)insn::deref(_segments, proc_enforce_ptr);
+    loc_t proc_enforce_val_loc = (loc_t)deref(proc_enforce_ptr);
     
     uint8_t mypatch = 1;
     return {proc_enforce_val_loc,&mypatch,1};
@@ -887,12 +1291,26 @@ vector<patch> offsetfinder64::find_nosuid_off(){
 
     insn ldr(_segments,ref);
     
-    while (--ldr != insn::ldr);
+    ldr.prevOf(insn::ldr, insnIndex());
     
-    loc_t cbnz = find_rel_branch_source(ldr, 1);
+    loc_t cbnz = 0;
+    try {
+        cfg &g = functionCfg(ldr);
+        if (g.blockAt(ldr).start == (loc_t)ldr.pc()) {
+            for (loc_t src : g.branchesTo(ldr)) {
+                if (src < (loc_t)ldr.pc() && src > cbnz)
+                    cbnz = src; //closest branch from above, like find_rel_branch_source
+            }
+        }
+    } catch (tihmstar::exception &e) {
+        //function bounds heuristic failed
+    }
+    if (!cbnz)
+        cbnz = find_rel_branch_source(ldr, 1);
     
-    insn bl_vfs_context_is64bit(ldr,cbnz);
-    while (--bl_vfs_context_is64bit != insn::bl || bl_vfs_context_is64bit.imm() != (uint64_t)find_sym("_vfs_context_is64bit"));
+    const callgraph::call *bl = callGraph().lastCallTo(find_sym("_vfs_context_is64bit"), cbnz);
+    retassure(bl, "Failed to find call to vfs_context_is64bit");
+    insn bl_vfs_context_is64bit(ldr,bl->site);
     
     //patch1
     insn movk(bl_vfs_context_is64bit);
@@ -905,12 +1323,9 @@ vector<patch> offsetfinder64::find_nosuid_off(){
     return {{(loc_t)movk.pc(),patch_nop,patch_nop_size},{(loc_t)orr.pc(),"\xE9\x03\x08\x2A",4}}; // mov w9, w8
 }
 
+#define SYSCALL_MAC_MOUNT 424
 patch offsetfinder64::find_remount_patch_offset(){
-    loc_t off = find_syscall0();
-    
-    loc_t syscall_mac_mount = (off + 3*(424-1)*sizeof(uint64_t));
-
-    loc_t __mac_mount = (loc_t)insn::deref(_segments, syscall_mac_mount);
+    loc_t __mac_mount = syscalls().syscall(SYSCALL_MAC_MOUNT).handler;
     
     insn patchloc(_segments, __mac_mount);
     
@@ -935,21 +1350,22 @@ patch offsetfinder64::find_lwvm_patch_offsets(){
     
     insn dstfunc(functop);
     loc_t destination = 0;
-    while (1) {
-        while (++dstfunc != insn::bl);
-        
-        try {
-            destination = jump_stub_call_ptr_loc(dstfunc);
-        } catch (tihmstar::bad_branch_destination &e) {
-            continue;
-        }
-        
-        if (haveSymbols()) {
-            if (insn::deref(_segments, destination) == (uint64_t)find_sym("_PE_i_can_has_kernel_configuration"))
-                break;
-        }else{
-            //check for _memcmp function signature
-            insn checker(_segments, (loc_t)insn::deref(_segments, destination));
+    if (loc_t sym = lookup_sym("_PE_i_can_has_kernel_configuration")) {
+        const callgraph::call *bl = first_stub_call_to(*this, sym, functop);
+        retassure(bl, "Failed to find call to PE_i_can_has_kernel_configuration stub");
+        destination = jumpStubs().find(bl->target)->slot;
+        dstfunc = bl->site;
+    }else{
+        while (1) {
+            dstfunc.nextOf(insn::bl, insnIndex());
+            
+            const jumpstubs::stub *stub = jumpStubs().find((loc_t)dstfunc.imm());
+            if (!stub || !stub->target)
+                continue;
+            destination = stub->slot;
+            
+            //check for _PE_i_can_has_kernel_configuration function signature
+            insn checker(_segments, stub->target);
             uint8_t reg = 0;
             if ((checker == insn::adrp && (static_cast<void>(reg = checker.rd()),true))
                 && (++checker == insn::add && checker.rd() == reg)
@@ -959,7 +1375,6 @@ patch offsetfinder64::find_lwvm_patch_offsets(){
                 break;
             }
         }
-        
     }
     
     while (++dstfunc != insn::bcond || dstfunc.other() != insn::cond::NE);
@@ -973,106 +1388,36 @@ loc_t offsetfinder64::find_sbops(){
     loc_t str = findstr("Seatbelt sandbox policy", false);
     retassure(str, "Failed to find str");
     
-    loc_t ref = memmem(&str, sizeof(str));
+    loc_t ref = pointers().firstRefTo(str);
     retassure(ref, "Failed to find ref");
     
-    return (loc_t)insn::deref(_segments, ref+0x18);
+    return (loc_t)deref(ref+0x18);
 }
 
-enum OFVariableType : uint32_t{
-    kOFVariableTypeBoolean = 1,
-    kOFVariableTypeNumber,
-    kOFVariableTypeString,
-    kOFVariableTypeData
-} ;
-
-enum OFVariablePerm : uint32_t{
-    kOFVariablePermRootOnly = 0,
-    kOFVariablePermUserRead,
-    kOFVariablePermUserWrite,
-    kOFVariablePermKernelOnly
-};
-struct OFVariable {
-    const char *variableName;
-    OFVariableType     variableType;
-    OFVariablePerm     variablePerm;
-    uint32_t           _padding;
-    uint32_t           variableOffset;
-};
-
-
 patch offsetfinder64::find_nonceEnabler_patch(){
-    if (!haveSymbols()){
-        info("Falling back to find_nonceEnabler_patch_nosym, because we don't have symbols");
-        return find_nonceEnabler_patch_nosym();
-    }
-    
-    loc_t str = findstr("com.apple.System.boot-nonce",true);
-    retassure(str, "Failed to find str");
-    
-    loc_t sym = find_sym("_gOFVariables");
-    
-    insn ptr(_segments,sym, insn::kText_and_Data);
-    
-#warning TODO: doublecast works, but is still kinda ugly
-    OFVariable *varp = (OFVariable*)(void*)ptr;
-    OFVariable nullvar = {0};
-    for (OFVariable *vars = varp;memcmp(vars, &nullvar, sizeof(OFVariable)) != 0; vars++) {
-        
-        if ((loc_t)vars->variableName == str) {
-            uint8_t mypatch = (uint8_t)kOFVariablePermUserWrite;
-            loc_t location =  sym + ((uint8_t*)&vars->variablePerm - (uint8_t*)varp);
-            return {location,&mypatch,1};
-        }
-    }
-    
-    reterror("failed to find \"com.apple.System.boot-nonce\"");
-    return {0,0,0};
+    return ofvariables().permPatch("com.apple.System.boot-nonce", kOFVariablePermUserWrite);
 }
 
 patch offsetfinder64::find_nonceEnabler_patch_nosym(){
-    loc_t str = findstr("com.apple.System.boot-nonce",true);
-    retassure(str, "Failed to find str");
-    
-    loc_t valref = memmem(&str, sizeof(str));
-    retassure(valref, "Failed to find val ref");
-    
-    loc_t str2 = findstr("com.apple.System.sep.art",true);
-    retassure(str2, "Failed to find str2");
-    
-    loc_t valref2 = memmem(&str2, sizeof(str2));
-    retassure(valref2, "Failed to find val ref2");
-    
-    auto diff = abs(valref - valref2);
-    
-    assure(diff % sizeof(OFVariable) == 0 && diff < 0x50); //simple sanity check
-    
-    insn ptr(_segments, valref, insn::kText_and_Data);
-
-    OFVariable *vars = (OFVariable*)(void*)ptr;
-    if ((loc_t)vars->variableName == str) {
-        uint8_t mypatch = (uint8_t)kOFVariablePermUserWrite;
-        loc_t location = valref + offsetof(OFVariable, variablePerm);
-        return {location,&mypatch,1};
-    }
-    
-    reterror("failed to find \"com.apple.System.boot-nonce\"");
-    return {0,0,0};
+    //the variable table finds itself without symbols if it has to
+    return find_nonceEnabler_patch();
 }
 
 #pragma mark KPP bypass
 loc_t offsetfinder64::find_gPhysBase(){
-    loc_t ref = find_sym("_ml_static_ptovirt");
+    loc_t ref = lookup_sym("_ml_static_ptovirt");
+    if (!ref)
+        return find_gPhysBase_nosym();
     
     insn tgtref(_segments, ref);
     
     loc_t gPhysBase = 0;
     
     if (tgtref != insn::adrp)
-        while (++tgtref != insn::adrp);
+        tgtref.nextOf(insn::adrp, insnIndex());
     gPhysBase = (loc_t)tgtref.imm();
     
-    while (++tgtref != insn::ldr);
+    tgtref.nextOf(insn::ldr, insnIndex());
     gPhysBase += tgtref.imm();
     
     return gPhysBase;
@@ -1089,18 +1434,18 @@ loc_t offsetfinder64::find_gPhysBase_nosym(){
 
     loc_t gPhysBase = 0;
     
-    while (++tgtref != insn::adrp);
+    tgtref.nextOf(insn::adrp, insnIndex());
     gPhysBase = (loc_t)tgtref.imm();
     
-    while (++tgtref != insn::ldr);
+    tgtref.nextOf(insn::ldr, insnIndex());
     gPhysBase += tgtref.imm();
     
     return gPhysBase;
 }
 
 loc_t offsetfinder64::find_kernel_pmap(){
-    if (haveSymbols()) {
-        return find_sym("_kernel_pmap");
+    if (loc_t sym = lookup_sym("_kernel_pmap")) {
+        return sym;
     }else{
         return find_kernel_pmap_nosym();
     }
@@ -1114,10 +1459,10 @@ loc_t offsetfinder64::find_kernel_pmap_nosym(){
     retassure(ref, "literal ref to str");
     
     insn btm(_segments,ref);
-    while (++btm != insn::ret);
+    btm.nextOf(insn::ret, insnIndex());
     
     insn kerne_pmap_ref(btm);
-    while (--kerne_pmap_ref != insn::adrp);
+    kerne_pmap_ref.prevOf(insn::adrp, insnIndex());
     
     uint8_t reg = kerne_pmap_ref.rd();
     loc_t kernel_pmap = (loc_t)kerne_pmap_ref.imm();
@@ -1141,13 +1486,13 @@ loc_t offsetfinder64::find_idlesleep_str_loc(){
     assure(finder == insn::b);
     
     insn deepsleepfinder(finder, (loc_t)finder.imm());
-    while (--deepsleepfinder != insn::nop);
+    deepsleepfinder.prevOf(insn::nop, insnIndex());
     
     loc_t fref = find_literal_ref(_segments, (loc_t)(deepsleepfinder.pc())+4+0xC);
     
     insn str(finder,fref);
-    while (++str != insn::str);
-    while (++str != insn::str);
+    str.nextOf(insn::str, insnIndex());
+    str.nextOf(insn::str, insnIndex());
     
     loc_t idlesleep_str_loc = (loc_t)str.imm();
     int rn = str.rn();
@@ -1164,12 +1509,12 @@ loc_t offsetfinder64::find_deepsleep_str_loc(){
     assure(finder == insn::b);
     
     insn deepsleepfinder(finder, (loc_t)finder.imm());
-    while (--deepsleepfinder != insn::nop);
+    deepsleepfinder.prevOf(insn::nop, insnIndex());
     
     loc_t fref = find_literal_ref(_segments, (loc_t)(deepsleepfinder.pc())+4+0xC);
     
     insn str(finder,fref);
-    while (++str != insn::str);
+    str.nextOf(insn::str, insnIndex());
     
     loc_t idlesleep_str_loc = (loc_t)str.imm();
     int rn = str.rn();
@@ -1194,13 +1539,18 @@ loc_t offsetfinder64::find_allproc(){
     
     while (++ptr != insn::and_ || ptr.rd() != 8 || ptr.rn() != 8 || ptr.imm() != 0xffffffffffffdfff);
 
-    loc_t retval = (loc_t)find_register_value(ptr-2, 8);
+    loc_t where = ptr-2;
+    loc_t retval = 0;
+    regtracker &rt = functionRegtracker(where);
+    if (!rt.loadAddress(where, 8, &retval) && !rt.value(where, 8, (uint64_t*)&retval))
+        retval = (loc_t)find_register_value(where, 8);
     
     return retval;
 }
 
 offsetfinder64::~offsetfinder64(){
     if (_freeKernel) safeFree(_kdata);
+    if (_kmap) munmap(_kmap, _kmapSize);
 }
 
 
@@ -7,122 +7,483 @@
 //
 
 #include <iostream>
+#include <unistd.h>
+#include <getopt.h>
 #include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/batch.hpp>
+#include <liboffsetfinder64/server.hpp>
+#include <liboffsetfinder64/slideview.hpp>
+#include <liboffsetfinder64/matchers.hpp>
+#include <liboffsetfinder64/classify.hpp>
+#include <liboffsetfinder64/porting.hpp>
+#include <limits.h>
+#include <chrono>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
 
 using namespace std;
 using namespace tihmstar;
-typedef uint64_t kptr_t;
+using namespace tihmstar::patchfinder64;
 
-int main(int argc, const char * argv[]) {
-    offsetfinder64 fi(argv[1]);
-    
-    [](offsetfinder64 *fi){
-        kptr_t ipc_space_is_task =                (kptr_t)fi->find_ipc_space_is_task_11();
-        
-        kptr_t zone_map =                         (kptr_t)fi->find_zone_map();
-
-        kptr_t sizeof_task =                      (kptr_t)fi->find_sizeof_task();
-
-        kptr_t task_itk_registered =              (kptr_t)fi->find_task_itk_registered();
-        kptr_t vtab_get_retain_count =            (kptr_t)fi->find_vtab_get_retain_count();
-        kptr_t task_bsd_info =                    (kptr_t)fi->find_task_bsd_info();
-
-        kptr_t vtab_get_external_trap_for_index = (kptr_t)fi->find_vtab_get_external_trap_for_index();
-        kptr_t proc_ucred =                       (kptr_t)fi->find_proc_ucred();
-
-        
-//        kptr_t task_itk_self =                    (kptr_t)fi->find_task_itk_self();
-        kptr_t vm_map_hdr =                       (kptr_t)fi->find_vm_map_hdr();
-        kptr_t realhost_special =                 0x10;
-//        kptr_t iouserclient_ipc =                 (kptr_t)fi->find_iouserclient_ipc();
-//
-        kptr_t kernel_map =                       (kptr_t)fi->find_kernel_map();
-        kptr_t kernel_task =                      (kptr_t)fi->find_kernel_task();
-        kptr_t realhost =                         (kptr_t)fi->find_realhost();
-        kptr_t copyin =                           (kptr_t)fi->find_copyin();
-        kptr_t copyout =                          (kptr_t)fi->find_copyout();
-        kptr_t chgproccnt =                       (kptr_t)fi->find_chgproccnt();
-        kptr_t kauth_cred_ref =                   (kptr_t)fi->find_kauth_cred_ref();
-        kptr_t ipc_port_alloc_special =           (kptr_t)fi->find_ipc_port_alloc_special();
-        kptr_t ipc_kobject_set =                  (kptr_t)fi->find_ipc_kobject_set();
-        kptr_t ipc_port_make_send =               (kptr_t)fi->find_ipc_port_make_send();
-        kptr_t osserializer_serialize =           (kptr_t)fi->find_osserializer_serialize();
-        kptr_t rop_ldr_x0_x0_0x10 =               (kptr_t)fi->find_rop_ldr_x0_x0_0x10();
+static struct option longopts[] = {
+    { "help",       no_argument,        NULL, 'h' },
+    { "list",       no_argument,        NULL, 'l' },
+    { "jobs",       required_argument,  NULL, 'j' },
+    { "memory",     required_argument,  NULL, 'm' },
+    { "finders",    required_argument,  NULL, 'f' },
+    { "server",     required_argument,  NULL, 's' },
+    { "cache",      required_argument,  NULL, 'n' },
+    { "connect",    required_argument,  NULL, 'c' },
+    { "request",    required_argument,  NULL, 'r' },
+    { "stress",     required_argument,  NULL, 't' },
+    { "slide",      required_argument,  NULL, 'S' },
+    { "bench",      no_argument,        NULL, 'b' },
+    { "matchbench", no_argument,        NULL, 'M' },
+    { "analysis",   required_argument,  NULL, 'a' },
+    { "port",       required_argument,  NULL, 'p' },
+    { "reference",  required_argument,  NULL, 'y' },
+    { "symbols",    required_argument,  NULL, 'Y' },
+    { "kexts",      required_argument,  NULL, 'K' },
+    { NULL, 0, NULL, 0 }
+};
 
+//resident memory of this process in bytes, 0 if unknown
+static size_t residentSize(){
+#ifdef __APPLE__
+    struct mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS)
+        return 0;
+    return (size_t)info.resident_size;
+#else
+    size_t pages = 0, resident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f)
+        return 0;
+    if (fscanf(f, "%zu %zu", &pages, &resident) != 2)
+        resident = 0;
+    fclose(f);
+    return resident * (size_t)getpagesize();
+#endif
+}
 
-        for (kptr_t *s = &sizeof_task; s>=&rop_ldr_x0_x0_0x10; s--) {
-            printf("%p\n",*s);
-        }
+static double msSince(chrono::steady_clock::time_point start){
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count() / 1000.0;
+}
 
-        printf("");
+void cmd_help(){
+    printf("Usage: offsetfinder64 [OPTIONS] KERNEL [KERNEL ...]\n");
+    printf("       offsetfinder64 -s SOCKET [-j NUM] [-n NUM]\n");
+    printf("       offsetfinder64 -c SOCKET [-f NAME[,NAME]] [-r REQUEST] [KERNEL ...]\n");
+    printf("Runs finders on kernels and prints one JSON line per kernel\n\n");
+    printf("  -h, --help\t\t\tprints usage information\n");
+    printf("  -l, --list\t\t\tlist available finders\n");
+    printf("  -j, --jobs NUM\t\tnumber of worker threads (default: number of cpus)\n");
+    printf("  -m, --memory MB\t\tbudget for the combined file size of concurrently loaded kernels (default: unlimited)\n");
+    printf("  -f, --finders NAME[,NAME]\tfinders to run (default: all)\n");
+    printf("  -s, --server SOCKET\t\tserve offset requests on a unix socket\n");
+    printf("  -n, --cache NUM\t\tnumber of kernels the server keeps loaded (default: 4)\n");
+    printf("  -c, --connect SOCKET\t\tquery a running server (sends \"stats\" if no kernel is given)\n");
+    printf("  -r, --request LINE\t\tsend a raw request line to the server\n");
+    printf("  -b, --bench\t\t\trun every finder on a fresh instance and report time and resident memory\n");
+    printf("  -M, --matchbench\t\tcompare insn lambda, pattern and template matchers on add x0,x0,#0x40; ret\n");
+    printf("  -S, --slide SLIDE\t\tadd SLIDE to reported addresses and patches\n");
+    printf("  -t, --stress NUM\t\trun all finders from NUM threads on one instance and compare results\n");
+    printf("  -a, --analysis FILE\t\tsave function fingerprints and finder results of the first kernel to FILE\n");
+    printf("  -p, --port FILE\t\tport results from an analysis FILE to the given kernels, rerun what can't be ported\n");
+    printf("  -y, --reference KERNEL\t\tsymbolicate stripped kernels from a symbolized reference KERNEL\n");
+    printf("  -Y, --symbols DIR\t\tcache symbolicated symbol tables in DIR\n");
+    printf("  -K, --kexts DIR\t\tkeep finder results per kext in DIR and reuse them for unchanged kexts\n");
+    printf("\n");
+}
 
-    }(&fi);
+int main(int argc, const char * argv[]) {
+    int opt = 0;
+    unsigned jobs = std::thread::hardware_concurrency();
+    size_t sizeBudget = 0;
+    vector<const finder*> finders;
+    const char *serverSocket = NULL;
+    const char *clientSocket = NULL;
+    const char *rawRequest = NULL;
+    size_t cacheSize = 4;
+    unsigned stressThreads = 0;
+    uint64_t slide = 0;
+    bool bench = false;
+    bool matchbench = false;
+    const char *analysisFile = NULL;
+    const char *portFile = NULL;
+    const char *referenceKernel = NULL;
+    const char *symbolsDir = NULL;
+    const char *kextsDir = NULL;
+    string finderNames;
     
-    tihmstar::patchfinder64::loc_t add_x0_x0_0x40_ret = fi.find_exec([](patchfinder64::insn &i)->bool{
-        if (i == patchfinder64::insn::add && i.rd() == 0 && i.rn() == 0 && i.imm() == 0x40) {
-            if (i+1 == patchfinder64::insn::ret) {
-                return true;
+    while ((opt = getopt_long(argc, (char* const *)argv, "hlj:m:f:s:n:c:r:t:S:bMa:p:y:Y:K:", longopts, NULL)) > 0) {
+        switch (opt) {
+            case 'h':
+                cmd_help();
+                return 0;
+            case 'l':
+                for (auto &f : finderRegistry())
+                    printf("%s\n",f.name);
+                return 0;
+            case 'j':
+                jobs = (unsigned)atoi(optarg);
+                break;
+            case 'm':
+                sizeBudget = (size_t)strtoull(optarg, NULL, 0)*1024*1024;
+                break;
+            case 'f':
+            {
+                string names = optarg;
+                finderNames += (finderNames.size() ? "," : "") + names;
+                size_t pos = 0;
+                while (pos <= names.size()) {
+                    size_t end = names.find(',', pos);
+                    if (end == string::npos) end = names.size();
+                    string name = names.substr(pos, end-pos);
+                    pos = end+1;
+                    if (name.empty())
+                        continue;
+                    const finder *f = finderNamed(name);
+                    if (!f) {
+                        cout << "unknown finder " << name << endl;
+                        return -1;
+                    }
+                    finders.push_back(f);
+                }
+                break;
             }
+            case 's':
+                serverSocket = optarg;
+                break;
+            case 'n':
+                cacheSize = (size_t)atoi(optarg);
+                break;
+            case 'c':
+                clientSocket = optarg;
+                break;
+            case 'r':
+                rawRequest = optarg;
+                break;
+            case 't':
+                stressThreads = (unsigned)atoi(optarg);
+                break;
+            case 'S':
+                slide = strtoull(optarg, NULL, 0);
+                break;
+            case 'b':
+                bench = true;
+                break;
+            case 'M':
+                matchbench = true;
+                break;
+            case 'a':
+                analysisFile = optarg;
+                break;
+            case 'p':
+                portFile = optarg;
+                break;
+            case 'y':
+                referenceKernel = optarg;
+                break;
+            case 'Y':
+                symbolsDir = optarg;
+                break;
+            case 'K':
+                kextsDir = optarg;
+                break;
+            default:
+                cmd_help();
+                return -1;
         }
-        return false;
-    });
+    }
     
-    printf("/*------------------------ KPP -------------------------- */\n");
-    uint64_t slide = 0;
-    /*------------------------ KPP -------------------------- */
-    tihmstar::patchfinder64::loc_t gPhysBase = fi.find_gPhysBase();
-    uint64_t entryp = (uint64_t)fi.find_entry();
-    uint64_t rvbar = entryp & (~0xFFF);
-    uint64_t cpul = fi.find_register_value((tihmstar::patchfinder64::loc_t)rvbar+0x40-slide, 1)+slide;
-    uint64_t optr = fi.find_register_value((tihmstar::patchfinder64::loc_t)rvbar+0x58-slide, 20)+slide;
-    tihmstar::patchfinder64::loc_t idlesleep = fi.find_idlesleep_str_loc();
-    tihmstar::patchfinder64::loc_t deepsleep = fi.find_deepsleep_str_loc();
-
-    tihmstar::patchfinder64::loc_t allproc = fi.find_allproc();
-
-    tihmstar::patchfinder64::loc_t kernel_pmap = fi.find_kernel_pmap();
+    if (serverSocket) {
+        offsetserver server(serverSocket, jobs, cacheSize);
+        info("Serving on %s",serverSocket);
+        server.serve();
+        return 0;
+    }
     
+    if (clientSocket) {
+        if (finderNames.empty()) {
+            for (auto &f : finderRegistry())
+                finderNames += (finderNames.size() ? "," : "") + string(f.name);
+        }
+        char slidearg[0x20] = {};
+        if (slide)
+            snprintf(slidearg, sizeof(slidearg), " 0x%llx", (unsigned long long)slide);
+        vector<string> requests;
+        if (rawRequest)
+            requests.push_back(rawRequest);
+        for (int i=optind; i<argc; i++) {
+            char abspath[PATH_MAX];
+            const char *kernel = realpath(argv[i], abspath) ? abspath : argv[i]; //the server has its own cwd
+            requests.push_back(string("find ") + kernel + " " + finderNames + slidearg);
+        }
+        if (requests.empty())
+            requests.push_back("stats");
+        for (auto &r : requests)
+            printf("%s\n",offsetserver::request(clientSocket, r).c_str());
+        return 0;
+    }
     
-    for (tihmstar::patchfinder64::loc_t *s = &gPhysBase; s>=&kernel_pmap; s--) {
-        printf("%p\n",*s);
+    if (optind >= argc) {
+        cmd_help();
+        return -1;
     }
-
-    printf("/*------------------------ kernelpatches -------------------------- */\n");
-
-    /*------------------------ kernelpatches -------------------------- */
-    tihmstar::patchfinder64::patch i_can_has_debugger_patch_off = fi.find_i_can_has_debugger_patch_off();
-    tihmstar::patchfinder64::patch lwvm_patch_offsets = fi.find_lwvm_patch_offsets();
-    tihmstar::patchfinder64::patch remount_patch_offset = fi.find_remount_patch_offset();
-    tihmstar::patchfinder64::patch proc_enforce = fi.find_proc_enforce();
-    tihmstar::patchfinder64::patch amfi_patch_offsets = fi.find_amfi_patch_offsets();
-    tihmstar::patchfinder64::patch cs_enforcement_disable_amfi = fi.find_cs_enforcement_disable_amfi();
-    tihmstar::patchfinder64::patch amfi_substrate_patch = fi.find_amfi_substrate_patch();
-    tihmstar::patchfinder64::patch sandbox_patch = fi.find_sandbox_patch();
-    tihmstar::patchfinder64::patch nonce = fi.find_nonceEnabler_patch();
     
+    vector<string> kernels;
+    for (int i=optind; i<argc; i++)
+        kernels.push_back(argv[i]);
     
-    auto nosuid_off = fi.find_nosuid_off();
-    auto sbops = fi.find_sbops();
+    if (finders.empty()) {
+        for (auto &f : finderRegistry())
+            finders.push_back(&f);
+    }
     
-    for (tihmstar::patchfinder64::patch *s = &i_can_has_debugger_patch_off; s>=&nonce; s--) {
-        printf("%p\n",s->_location);
+    //results go to the real stdout, everything the library prints goes to stderr
+    int resultfd = dup(STDOUT_FILENO);
+    FILE *results = fdopen(resultfd, "w");
+    if (!results) {
+        cout << "failed to open stdout" << endl;
+        return -1;
     }
+    fflush(stdout);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
     
-    for (auto s : nosuid_off) {
-        printf("%p\n",s._location);
+    if (stressThreads) {
+        //every thread runs all finders on the same cold instance, starting at a different finder
+        offsetfinder64 fi(kernels[0].c_str());
+        vector<vector<string>> res(stressThreads, vector<string>(finders.size()));
+        vector<thread> threads;
+        for (unsigned t=0; t<stressThreads; t++) {
+            threads.push_back(thread([&, t]{
+                for (size_t k=0; k<finders.size(); k++) {
+                    size_t i = (k + t) % finders.size();
+                    string r;
+                    res[t][i] = runFinder(finders[i], fi, r) ? r : "error: " + r;
+                }
+            }));
+        }
+        for (auto &t : threads)
+            t.join();
+        
+        size_t mismatches = 0;
+        for (size_t i=0; i<finders.size(); i++) {
+            for (unsigned t=1; t<stressThreads; t++) {
+                if (res[t][i] != res[0][i]) {
+                    fprintf(results, "{\"finder\":%s,\"thread\":%u,\"expected\":%s,\"got\":%s}\n",jsonString(finders[i]->name).c_str(),t,
+                            jsonString(res[0][i]).c_str(),jsonString(res[t][i]).c_str());
+                    mismatches++;
+                }
+            }
+        }
+        fprintf(results, "{\"kernel\":%s,\"threads\":%u,\"finders\":%zu,\"mismatches\":%zu}\n",jsonString(kernels[0]).c_str(),stressThreads,finders.size(),mismatches);
+        fclose(results);
+        return mismatches ? 1 : 0;
     }
-    printf("%p\n",sbops);
     
-    printf("/*------------------------ Util -------------------------- */\n");
-    tihmstar::patchfinder64::loc_t vnode = fi.find_rootvnode();
+    if (matchbench) {
+        //best of a few runs: time to the first match (what find_exec does) and a full scan counting all matches
+        offsetfinder64 fi(kernels[0].c_str());
+        const int runs = 5;
+        auto lambdaMatch = [](patchfinder64::insn &i)->bool{
+            if (i == patchfinder64::insn::add && i.rd() == 0 && i.rn() == 0 && i.imm() == 0x40) {
+                if (i+1 == patchfinder64::insn::ret) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        static const pattern gadgetPattern("add x0, x0, #0x40 ; ret");
+        typedef matchers::seq<matchers::add_imm<0,0,0x40>, matchers::ret> gadget;
+        
+        struct matcher{
+            const char *name;
+            function<loc_t()> first;
+            function<size_t()> count;
+        };
+        vector<matcher> candidates = {
+            {"lambda", [&]{return fi.find_exec(lambdaMatch);}, [&]{
+                size_t n = 0;
+                fi.find_exec([&](patchfinder64::insn &i)->bool{
+                    try {
+                        n += lambdaMatch(i);
+                    } catch (tihmstar::out_of_range &e) {
+                        //i+1 past the last instruction
+                    }
+                    return false;
+                });
+                return n;
+            }},
+            {"pattern", [&]{return fi.find_exec(gadgetPattern);}, [&]{
+                size_t n = 0;
+                patternset set;
+                set.add(gadgetPattern);
+                set.scan(fi, [&](const patternmatch &){n++; return true;});
+                return n;
+            }},
+            {"template", [&]{return matchers::find<gadget>(fi.segments());}, [&]{return matchers::count<gadget>(fi.segments());}},
+        };
+        
+        for (auto &m : candidates) {
+            loc_t loc = 0;
+            size_t n = 0;
+            double firstMs = 0, scanMs = 0;
+            for (int r=0; r<runs; r++) {
+                auto start = chrono::steady_clock::now();
+                loc = m.first();
+                double ms = msSince(start);
+                if (!r || ms < firstMs) firstMs = ms;
+                
+                start = chrono::steady_clock::now();
+                n = m.count();
+                ms = msSince(start);
+                if (!r || ms < scanMs) scanMs = ms;
+            }
+            fprintf(results, "{\"kernel\":%s,\"matcher\":\"%s\",\"first\":%s,\"first_ms\":%.3f,\"matches\":%zu,\"scan_ms\":%.3f}\n",
+                    jsonString(kernels[0]).c_str(),m.name,jsonLoc(loc).c_str(),firstMs,n,scanMs);
+        }
+        
+        //classifying every exec word into all classes vs decoding the type of every instruction
+        size_t adrps = 0, typedAdrps = 0;
+        auto start = chrono::steady_clock::now();
+        for (auto &seg : fi.segments()) {
+            if (!seg.isExec)
+                continue;
+            const uint32_t *words = (const uint32_t *)seg.map;
+            size_t n = seg.size/4;
+            for (size_t blk=0; blk<n; blk+=kClassifyBlockWords) {
+                uint64_t hits[kInsnClassCount];
+                classifyBlock(words+blk, n-blk, hits);
+                adrps += __builtin_popcountll(hits[kInsnClassAdrp]);
+            }
+        }
+        double classifyMs = msSince(start);
+        start = chrono::steady_clock::now();
+        try {
+            for (patchfinder64::insn i(fi.segments());;++i)
+                typedAdrps += (i.type() == patchfinder64::insn::adrp);
+        } catch (tihmstar::out_of_range &e) {
+            //end of text
+        }
+        double typeMs = msSince(start);
+        fprintf(results, "{\"kernel\":%s,\"classifier\":\"%s\",\"classify_ms\":%.3f,\"adrp\":%zu,\"insn_type_ms\":%.3f,\"insn_adrp\":%zu}\n",
+                jsonString(kernels[0]).c_str(),classifyImplementation(),classifyMs,adrps,typeMs,typedAdrps);
+        fclose(results);
+        return 0;
+    }
     
-    printf("%p\n",vnode);
+    if (analysisFile) {
+        //results are stored unslid, the slide is applied when porting
+        offsetfinder64 fi(kernels[0].c_str());
+        analysis a;
+        a.prints = fi.functionPrints();
+        size_t failed = 0;
+        for (auto f : finders) {
+            string r;
+            if (runFinder(f, fi, r))
+                a.results[f->name] = r;
+            else
+                failed++;
+        }
+        a.save(analysisFile);
+        fprintf(results, "{\"kernel\":%s,\"analysis\":%s,\"functions\":%zu,\"results\":%zu,\"failed\":%zu}\n",jsonString(kernels[0]).c_str(),
+                jsonString(analysisFile).c_str(),a.prints.functions().size(),a.results.size(),failed);
+        fclose(results);
+        return 0;
+    }
     
-    printf("");
+    if (portFile) {
+        analysis a;
+        a.load(portFile);
+        size_t failed = 0;
+        for (auto &kernel : kernels) {
+            offsetfinder64 fi(kernel.c_str());
+            offsetporter porter(a.prints, fi.functionPrints());
+            size_t ported = 0, ran = 0;
+            for (auto f : finders) {
+                string r;
+                auto saved = a.results.find(f->name);
+                bool isPorted = saved != a.results.end() && porter.portResult(saved->second, slide, r);
+                bool ok = isPorted;
+                if (isPorted) {
+                    ported++;
+                }else{
+                    ran++;
+                    if (!(ok = runFinder(f, slideview(fi, slide), r)))
+                        failed++;
+                }
+                fprintf(results, "{\"kernel\":%s,\"finder\":%s,\"ported\":%s,\"%s\":%s}\n",jsonString(kernel).c_str(),jsonString(f->name).c_str(),
+                        isPorted ? "true" : "false", ok ? "result" : "error", ok ? r.c_str() : jsonString(r).c_str());
+            }
+            fprintf(results, "{\"kernel\":%s,\"functions\":%zu,\"matched\":%zu,\"exact\":%zu,\"ported\":%zu,\"ran\":%zu}\n",jsonString(kernel).c_str(),
+                    fi.functionPrints().functions().size(),porter.matches().size(),porter.exactMatches(),ported,ran);
+        }
+        fclose(results);
+        return failed ? 1 : 0;
+    }
     
+    if (bench) {
+        //a fresh instance per finder, so resident memory only counts what that finder touched
+        size_t failed = 0;
+        for (auto &kernel : kernels) {
+            for (auto f : finders) {
+                size_t rssBefore = residentSize();
+                auto start = chrono::steady_clock::now();
+                offsetfinder64 fi(kernel.c_str());
+                double loadMs = msSince(start);
+                size_t rssLoaded = residentSize();
+                
+                start = chrono::steady_clock::now();
+                string r;
+                bool ok = runFinder(f, slideview(fi, slide), r);
+                double ms = msSince(start);
+                size_t rssAfter = residentSize();
+                if (!ok) failed++;
+                
+                fprintf(results, "{\"kernel\":%s,\"finder\":%s,\"mapped\":%s,\"load_ms\":%.1f,\"ms\":%.1f,\"load_rss_kb\":%lld,\"finder_rss_kb\":%lld,\"%s\":%s}\n",
+                        jsonString(kernel).c_str(),jsonString(f->name).c_str(),fi.isMapped() ? "true" : "false",loadMs,ms,
+                        ((long long)rssLoaded - (long long)rssBefore)/1024,((long long)rssAfter - (long long)rssLoaded)/1024,
+                        ok ? "result" : "error", ok ? r.c_str() : jsonString(r).c_str());
+            }
+        }
+        fclose(results);
+        return failed ? 1 : 0;
+    }
     
-
+    size_t failed = 0;
+    {
+        batchdriver driver(jobs, sizeBudget, results);
+        if (kextsDir)
+            driver.setStore(std::shared_ptr<kextstore>(new kextstore(kextsDir)));
+        std::shared_ptr<offsetfinder64> reference;
+        if (referenceKernel) {
+            reference = std::shared_ptr<offsetfinder64>(new offsetfinder64(referenceKernel));
+            driver.setPrepare([&](offsetfinder64 &fi){
+                if (fi.haveSymtab())
+                    return;
+                string cache;
+                if (symbolsDir && fi.uuid().size())
+                    cache = string(symbolsDir) + "/" + reference->uuid() + "-" + fi.uuid() + ".syms";
+                std::shared_ptr<symbolmap> syms;
+                if (cache.size() && access(cache.c_str(), R_OK) == 0) {
+                    syms = std::shared_ptr<symbolmap>(new symbolmap());
+                    syms->load(cache.c_str());
+                }else{
+                    syms = std::shared_ptr<symbolmap>(new symbolmap(*reference, fi));
+                    if (cache.size())
+                        syms->save(cache.c_str());
+                }
+                info("Synthesized %zu symbols for %s",syms->size(),fi.uuid().c_str());
+                fi.useSymbols(syms);
+            });
+        }
+        failed = driver.run(kernels, finders, slide);
+    }
+    fclose(results);
     
-    std::cout << "Done!\n";
-    return 0;
+    return failed ? 1 : 0;
 }
@@ -0,0 +1,125 @@
+//
+//  mig.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "mig.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/mig.hpp>
+#include "all_liboffsetfinder.hpp"
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+#define MIG_MAX_ROUTINES 0x400
+#define MIG_MAX_MSG_SIZE 0x100000
+#define MIG_MAX_ARGS 0x40
+
+struct mig_subsystem_raw{
+    uint64_t server;
+    uint32_t start;
+    uint32_t end;
+    uint32_t maxsize;
+    uint32_t _padding;
+    uint64_t reserved;
+};
+
+struct routine_descriptor_raw{
+    uint64_t impl_routine;
+    uint64_t stub_routine;
+    uint32_t argc;
+    uint32_t descr_count;
+    uint64_t arg_descr;
+    uint32_t max_reply_msg;
+    uint32_t _padding;
+};
+
+migtable::migtable(offsetfinder64 &of){
+    scan(of);
+}
+
+void migtable::scan(offsetfinder64 &of){
+    auto isCodeOrNull = [&](uint64_t ptr)->bool{
+        if (!ptr)
+            return true;
+        const text_t *seg = of.segmentForLoc((loc_t)ptr);
+        return seg && seg->isExec;
+    };
+    
+    for (auto &seg : of.segments()) {
+        if (seg.isExec || !seg.size)
+            continue;
+        const uint8_t *map = (const uint8_t *)of.rebasedMemoryForLoc(seg.base, seg.size);
+        if (!map)
+            continue;
+        
+        for (size_t off = 0; off + sizeof(mig_subsystem_raw) <= seg.size; off += sizeof(uint64_t)) {
+            const mig_subsystem_raw *hdr = (const mig_subsystem_raw *)(map + off);
+            
+            //cheap checks first, this runs for every word in data
+            if (hdr->start >= hdr->end || hdr->end - hdr->start > MIG_MAX_ROUTINES || hdr->reserved)
+                continue;
+            if (hdr->maxsize < 0x18 || hdr->maxsize > MIG_MAX_MSG_SIZE || !hdr->server || !isCodeOrNull(hdr->server))
+                continue;
+            
+            uint32_t cnt = hdr->end - hdr->start;
+            if (off + sizeof(mig_subsystem_raw) + cnt*sizeof(routine_descriptor_raw) > seg.size)
+                continue;
+            
+            const routine_descriptor_raw *routines = (const routine_descriptor_raw *)(hdr+1);
+            bool valid = true;
+            bool haveRoutine = false;
+            for (uint32_t i=0; i<cnt && valid; i++) {
+                const routine_descriptor_raw &r = routines[i];
+                valid = isCodeOrNull(r.impl_routine) && isCodeOrNull(r.stub_routine)
+                    && r.argc <= MIG_MAX_ARGS && r.descr_count <= MIG_MAX_ARGS
+                    && r.max_reply_msg <= MIG_MAX_MSG_SIZE;
+                haveRoutine |= (r.stub_routine != 0);
+            }
+            if (!valid || !haveRoutine)
+                continue;
+            
+            mig_subsystem sub;
+            sub.location = seg.base + off;
+            sub.server = (loc_t)hdr->server;
+            sub.start = hdr->start;
+            sub.end = hdr->end;
+            sub.maxsize = hdr->maxsize;
+            sub.routines.reserve(cnt);
+            for (uint32_t i=0; i<cnt; i++) {
+                const routine_descriptor_raw &r = routines[i];
+                sub.routines.push_back({sub.start+i,(loc_t)r.impl_routine,(loc_t)r.stub_routine,r.argc,r.max_reply_msg});
+            }
+            
+            if (_byStart.find(sub.start) != _byStart.end()) {
+                warning("migtable: duplicate subsystem %u at %p, keeping first one",sub.start,sub.location);
+            }else{
+                size_t idx = _subsystems.size();
+                _byStart[sub.start] = idx;
+                for (uint32_t i=0; i<cnt; i++)
+                    _byMsgid[sub.start+i] = {idx,i};
+                _subsystems.push_back(std::move(sub));
+            }
+            
+            off += sizeof(routine_descriptor_raw)*cnt + sizeof(mig_subsystem_raw) - sizeof(uint64_t);
+        }
+    }
+}
+
+const mig_subsystem &migtable::subsystem(uint32_t start) const{
+    auto it = _byStart.find(start);
+    if (it == _byStart.end())
+        reterror("mig subsystem " + std::to_string(start) + " not found");
+    return _subsystems[it->second];
+}
+
+const mig_routine &migtable::routine(uint32_t msgid) const{
+    auto it = _byMsgid.find(msgid);
+    if (it == _byMsgid.end())
+        reterror("mig routine " + std::to_string(msgid) + " not found");
+    return _subsystems[it->second.first].routines[it->second.second];
+}
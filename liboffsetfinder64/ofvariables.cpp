@@ -0,0 +1,113 @@
+//
+//  ofvariables.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "ofvariables.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/ofvariables.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <stddef.h>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+#define OFVARIABLE_MAX_NAME 0x80
+#define OFVARIABLE_MAX_COUNT 0x400
+
+//matches xnu's OFVariable, offset is -1 for variables not backed by a field
+struct OFVariable {
+    uint64_t           variableName;
+    uint32_t           variableType;
+    uint32_t           variablePerm;
+    int32_t            variableOffset;
+    uint32_t           _padding;
+};
+
+//NULL unless ptr points to a printable, NUL terminated string
+static const char *varname(offsetfinder64 &of, uint64_t ptr){
+    const text_t *seg = of.segmentForLoc((loc_t)ptr);
+    if (!ptr || !seg)
+        return NULL;
+    const char *s = (const char *)(seg->map + ((loc_t)ptr - seg->base));
+    size_t max = (seg->base + seg->size) - (loc_t)ptr;
+    if (max > OFVARIABLE_MAX_NAME) max = OFVARIABLE_MAX_NAME;
+    for (size_t i=0; i<max; i++) {
+        if (!s[i])
+            return i ? s : NULL;
+        if (s[i] < 0x20 || s[i] > 0x7e)
+            return NULL;
+    }
+    return NULL;
+}
+
+static bool isValidVariable(offsetfinder64 &of, const OFVariable *v){
+    return v && v->variableType >= kOFVariableTypeBoolean && v->variableType <= kOFVariableTypeData
+        && v->variablePerm <= kOFVariablePermKernelOnly
+        && varname(of, v->variableName);
+}
+
+ofvariabletable::ofvariabletable(offsetfinder64 &of) :
+    _table(0)
+{
+    _table = of.lookup_sym("_gOFVariables");
+    if (!_table)
+        _table = findTableNoSym(of);
+    parse(of);
+}
+
+loc_t ofvariabletable::findTableNoSym(offsetfinder64 &of){
+    //any variable will do as an anchor, boot-nonce is present on all versions we care about
+    constexpr char anchorName[] = "com.apple.System.boot-nonce";
+    loc_t str = of.memmem(anchorName, sizeof(anchorName));
+    retassure(str, "Failed to find str");
+    
+    loc_t ref = of.pointers().firstRefTo(str);
+    retassure(ref, "Failed to find val ref");
+    
+    const text_t *seg = of.segmentForLoc(ref);
+    assure(seg);
+    
+    //walk back to the first entry
+    loc_t table = ref;
+    while (table - sizeof(OFVariable) >= seg->base) {
+        const OFVariable *prev = (const OFVariable *)of.rebasedMemoryForLoc(table - sizeof(OFVariable), sizeof(OFVariable));
+        if (!isValidVariable(of, prev))
+            break;
+        table -= sizeof(OFVariable);
+    }
+    return table;
+}
+
+void ofvariabletable::parse(offsetfinder64 &of){
+    const text_t *seg = of.segmentForLoc(_table);
+    retassure(seg, "gOFVariables not mapped");
+    
+    for (loc_t cur = _table; cur + sizeof(OFVariable) <= seg->base + seg->size && _vars.size() < OFVARIABLE_MAX_COUNT; cur += sizeof(OFVariable)) {
+        const OFVariable *v = (const OFVariable *)of.rebasedMemoryForLoc(cur, sizeof(OFVariable));
+        if (!v || !v->variableName)
+            break; //terminating entry
+        retassure(isValidVariable(of, v), "invalid OFVariable in gOFVariables");
+        
+        ofvariable var = {varname(of, v->variableName),(OFVariableType)v->variableType,(OFVariablePerm)v->variablePerm,v->variableOffset,cur};
+        _byName.insert({var.name, _vars.size()}); //first entry wins on duplicate names
+        _vars.push_back(var);
+    }
+    retassure(_vars.size(), "gOFVariables is empty");
+}
+
+const ofvariable &ofvariabletable::variable(const char *name) const{
+    auto it = _byName.find(name);
+    if (it == _byName.end())
+        reterror(std::string("failed to find \"") + name + "\"");
+    return _vars[it->second];
+}
+
+patch ofvariabletable::permPatch(const char *name, OFVariablePerm perm) const{
+    uint8_t mypatch = (uint8_t)perm;
+    return {variable(name).location + offsetof(OFVariable, variablePerm),&mypatch,1};
+}
@@ -31,6 +31,15 @@ void patch::slide(uint64_t slide){
     _slideme = false; //only slide once
 }
 
+patch patch::rebased(uint64_t slide) const{
+    if (!slide)
+        return *this;
+    patch ret(_location + slide, _patch, _patchSize, _slidefunc);
+    ret._slideme = _slideme;
+    ret.slide(slide);
+    return ret;
+}
+
 patch::~patch(){
     free((void*)_patch);
 }
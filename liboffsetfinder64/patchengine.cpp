@@ -0,0 +1,169 @@
+//
+//  patchengine.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "patchengine.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/patchengine.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <algorithm>
+
+extern "C"{
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/uio.h>
+}
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+patchengine::patchengine(offsetfinder64 &of, uint64_t slide) :
+    _of(of),
+    _slide(slide),
+    _validated(false)
+{
+    //
+}
+
+void patchengine::add(const patch &p){
+    _patches.push_back(p);
+    _validated = false;
+}
+
+void patchengine::add(const std::vector<patch> &patches){
+    _patches.reserve(_patches.size() + patches.size());
+    for (auto &p : patches)
+        _patches.push_back(p);
+    _validated = false;
+}
+
+void patchengine::prepare(){
+    if (_validated)
+        return;
+    validate();
+}
+
+void patchengine::validate(){
+    _sorted.clear();
+    _sorted.reserve(_patches.size());
+    
+    for (size_t i=0; i<_patches.size(); i++) {
+        patch &p = _patches[i];
+        const text_t *seg = _of.segmentForLoc(p._location);
+        retassure(seg, "patch location not in any segment");
+        retassure(p._location + p._patchSize <= seg->base + seg->size, "patch crosses segment boundary");
+        
+        p.slide(_slide); //patch guards against double sliding itself
+        _sorted.push_back({_of.fileOffsetForLoc(p._location),i});
+    }
+    
+    std::sort(_sorted.begin(), _sorted.end(), [](const entry &a, const entry &b){
+        return a.fileoff < b.fileoff;
+    });
+    
+    for (size_t i=1; i<_sorted.size(); i++) {
+        const entry &prev = _sorted[i-1];
+        retassure(prev.fileoff + _patches[prev.idx]._patchSize <= _sorted[i].fileoff, "patches overlap");
+    }
+    
+    _validated = true;
+}
+
+void patchengine::apply(void *buf, size_t bufSize){
+    prepare();
+    retassure(bufSize >= _of.ksize(), "buffer too small for kernel");
+    
+    for (auto &e : _sorted) {
+        const patch &p = _patches[e.idx];
+        memcpy((uint8_t*)buf + e.fileoff, p._patch, p._patchSize);
+    }
+}
+
+void patchengine::write(const char *filename){
+    int fd = -1;
+    auto clean =[&]{
+        if (fd>0) close(fd);
+    };
+    prepare();
+    
+    const uint8_t *kdata = (const uint8_t *)_of.kdata();
+    size_t ksize = _of.ksize();
+    
+    //interleave unpatched chunks of the original image with the patch buffers
+    std::vector<struct iovec> iov;
+    iov.reserve(_sorted.size()*2+1);
+    offset_t cur = 0;
+    for (auto &e : _sorted) {
+        const patch &p = _patches[e.idx];
+        if (e.fileoff > cur)
+            iov.push_back({(void*)(kdata+cur),(size_t)(e.fileoff-cur)});
+        iov.push_back({(void*)p._patch,p._patchSize});
+        cur = e.fileoff + p._patchSize;
+    }
+    if (cur < ksize)
+        iov.push_back({(void*)(kdata+cur),(size_t)(ksize-cur)});
+    
+    assure((fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644)) != -1);
+    
+    size_t pos = 0;
+    while (pos < iov.size()) {
+        int cnt = (int)std::min(iov.size()-pos, (size_t)IOV_MAX);
+        ssize_t didwrite = writev(fd, &iov[pos], cnt);
+        if (didwrite == -1 && errno == EINTR)
+            continue;
+        assureclean(didwrite > 0);
+        
+        //skip fully written vectors and adjust a partially written one
+        while (pos < iov.size() && (size_t)didwrite >= iov[pos].iov_len) {
+            didwrite -= iov[pos++].iov_len;
+        }
+        if (didwrite) {
+            iov[pos].iov_base = (uint8_t*)iov[pos].iov_base + didwrite;
+            iov[pos].iov_len -= didwrite;
+        }
+    }
+    
+    clean();
+}
+
+std::vector<patchengine::patchstate> patchengine::verify(offsetfinder64 &other, uint64_t locationSlide){
+    prepare();
+    std::vector<patchstate> ret(_patches.size(),kPatchUnknown);
+    const uint8_t *kdata = (const uint8_t *)_of.kdata();
+    
+    //walk in file order, so both images are touched front to back only once
+    const text_t *oseg = NULL;
+    for (auto &e : _sorted) {
+        const patch &p = _patches[e.idx];
+        loc_t oloc = p._location + locationSlide;
+        
+        if (!oseg || oloc < oseg->base || oloc >= oseg->base+oseg->size)
+            oseg = other.segmentForLoc(oloc);
+        if (!oseg || oloc + p._patchSize > oseg->base+oseg->size)
+            continue; //not mapped in other image, leave unknown
+        
+        const uint8_t *obytes = oseg->map + (oloc - oseg->base);
+        if (memcmp(obytes, p._patch, p._patchSize) == 0)
+            ret[e.idx] = kPatchApplied;
+        else if (memcmp(obytes, kdata + e.fileoff, p._patchSize) == 0)
+            ret[e.idx] = kPatchOriginal;
+    }
+    return ret;
+}
+
+std::vector<patchengine::patchstate> patchengine::verify(const std::vector<patch> &patches, offsetfinder64 &original, offsetfinder64 &other, uint64_t slide, uint64_t locationSlide){
+    patchengine engine(original,slide);
+    engine.add(patches);
+    return engine.verify(other, locationSlide);
+}
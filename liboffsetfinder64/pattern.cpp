@@ -0,0 +1,334 @@
+//
+//  pattern.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "pattern.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/pattern.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <ctype.h>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+/*
+ operand kinds:
+    d   register at bits 0-4 (Rd/Rt)
+    n   register at bits 5-9 (Rn)
+    b   base register at bits 5-9 in brackets, [xN] or [xN, #imm] (unsigned offset only)
+    m   register at bits 16-20 (Rm)
+    i   unsigned 12bit immediate at bits 10-21, scaled by the templates scale
+    h   16bit immediate at bits 5-20
+    l   label, only '?' is allowed
+ */
+struct insntemplate{
+    const char *mnemonic;
+    char width;         //'x' or 'w', register width of the first operand
+    uint32_t value;
+    uint32_t mask;
+    const char *ops;
+    uint8_t scale;
+    bool sp31;          //register 31 in d/n is sp instead of zr
+};
+
+static const insntemplate templates[] = {
+    {"add",  'x', 0x91000000, 0xFFC00000, "dni", 0, true},
+    {"add",  'w', 0x11000000, 0xFFC00000, "dni", 0, true},
+    {"sub",  'x', 0xD1000000, 0xFFC00000, "dni", 0, true},
+    {"sub",  'w', 0x51000000, 0xFFC00000, "dni", 0, true},
+    {"ldr",  'x', 0xF9400000, 0xFFC00000, "dbi", 3, false},
+    {"ldr",  'w', 0xB9400000, 0xFFC00000, "dbi", 2, false},
+    {"str",  'x', 0xF9000000, 0xFFC00000, "dbi", 3, false},
+    {"str",  'w', 0xB9000000, 0xFFC00000, "dbi", 2, false},
+    {"ldrb", 'w', 0x39400000, 0xFFC00000, "dbi", 0, false},
+    {"strb", 'w', 0x39000000, 0xFFC00000, "dbi", 0, false},
+    {"adrp", 'x', 0x90000000, 0x9F000000, "dl",  0, false},
+    {"adr",  'x', 0x10000000, 0x9F000000, "dl",  0, false},
+    {"mov",  'x', 0xAA0003E0, 0xFFE0FFE0, "dm",  0, false}, //orr xd, xzr, xm, mov to/from sp is add
+    {"mov",  'w', 0x2A0003E0, 0xFFE0FFE0, "dm",  0, false},
+    {"movz", 'x', 0xD2800000, 0xFFE00000, "dh",  0, false},
+    {"movz", 'w', 0x52800000, 0xFFE00000, "dh",  0, false},
+    {"cbz",  'x', 0xB4000000, 0xFF000000, "dl",  0, false},
+    {"cbz",  'w', 0x34000000, 0xFF000000, "dl",  0, false},
+    {"cbnz", 'x', 0xB5000000, 0xFF000000, "dl",  0, false},
+    {"cbnz", 'w', 0x35000000, 0xFF000000, "dl",  0, false},
+    {"br",   'x', 0xD61F0000, 0xFFFFFC1F, "n",   0, false},
+    {"blr",  'x', 0xD63F0000, 0xFFFFFC1F, "n",   0, false},
+    {"ret",  'x', 0xD65F03C0, 0xFFFFFFFF, "",    0, false},
+    {"b",    'x', 0x14000000, 0xFC000000, "l",   0, false},
+    {"bl",   'x', 0x94000000, 0xFC000000, "l",   0, false},
+    {"nop",  'x', 0xD503201F, 0xFFFFFFFF, "",    0, false},
+};
+
+static std::string trim(const std::string &s){
+    size_t b = s.find_first_not_of(" \t");
+    if (b == std::string::npos)
+        return "";
+    size_t e = s.find_last_not_of(" \t");
+    return s.substr(b, e-b+1);
+}
+
+static std::vector<std::string> split(const std::string &s, char sep){
+    std::vector<std::string> ret;
+    size_t pos = 0;
+    while (true) {
+        size_t end = s.find(sep, pos);
+        ret.push_back(s.substr(pos, end == std::string::npos ? std::string::npos : end-pos));
+        if (end == std::string::npos)
+            break;
+        pos = end+1;
+    }
+    return ret;
+}
+
+static bool isCapture(const std::string &s){
+    return s.size() == 1 && s[0] >= 'A' && s[0] <= 'Z';
+}
+
+#pragma mark patternmatch
+
+uint64_t patternmatch::capture(char name) const{
+    retassure(name >= 'A' && name <= 'Z' && (captured & (1u << (name-'A'))), std::string("capture ") + name + " not set");
+    return values[name-'A'];
+}
+
+#pragma mark pattern
+
+pattern::pattern(const std::string &src) :
+    _source(src)
+{
+    for (auto &insn : split(src, ';'))
+        compileInsn(trim(insn));
+    retassure(_steps.size(), "empty pattern");
+}
+
+void pattern::compileInsn(const std::string &src){
+    retassure(src.size(), "empty instruction in pattern \"" + _source + "\"");
+    if (src == "?") {
+        _steps.push_back({0,0,{}});
+        return;
+    }
+
+    size_t sp = src.find_first_of(" \t");
+    std::string mnemonic = src.substr(0, sp);
+    std::string operands = (sp != std::string::npos) ? trim(src.substr(sp)) : "";
+    std::vector<std::string> ops;
+    size_t memop = std::string::npos; //index of the first operand inside brackets
+    size_t open = operands.find('[');
+    if (open != std::string::npos) {
+        size_t close = operands.find(']', open);
+        retassure(close != std::string::npos, "missing ']' in \"" + src + "\"");
+        std::string after = trim(operands.substr(close+1));
+        retassure(after.empty(), std::string(after[0] == '!' ? "pre-index" : "post-index") + " addressing is not supported in \"" + src + "\"");
+        std::string before = trim(operands.substr(0, open));
+        retassure(before.size() && before.back() == ',', "expected ',' before '[' in \"" + src + "\"");
+        before.pop_back();
+        for (auto &op : split(before, ','))
+            ops.push_back(trim(op));
+        memop = ops.size();
+        for (auto &op : split(operands.substr(open+1, close-open-1), ','))
+            ops.push_back(trim(op));
+    }else if (operands.size()) {
+        for (auto &op : split(operands, ','))
+            ops.push_back(trim(op));
+    }
+    for (auto &c : mnemonic) c = (char)tolower(c);
+
+    char width = 'x';
+    if (ops.size() && ops[0].size() && (tolower(ops[0][0]) == 'w' || tolower(ops[0][0]) == 'x'))
+        width = (char)tolower(ops[0][0]);
+
+    const insntemplate *t = NULL;
+    for (auto &cur : templates) {
+        if (mnemonic == cur.mnemonic && width == cur.width) {
+            t = &cur;
+            break;
+        }
+    }
+    retassure(t, "unsupported instruction \"" + src + "\" in pattern \"" + _source + "\"");
+
+    size_t nops = strlen(t->ops);
+    const char *base = strchr(t->ops, 'b');
+    retassure(base ? memop == (size_t)(base - t->ops) : memop == std::string::npos, "wrong addressing in \"" + src + "\"");
+    if (base && ops.size() == nops-1)
+        ops.push_back("#0"); //[xN] without offset
+    retassure(ops.size() == nops, "wrong operand count in \"" + src + "\"");
+
+    step s = {t->mask, t->value, {}};
+    for (size_t k=0; k<nops; k++) {
+        std::string op = ops[k];
+        char kind = t->ops[k];
+        uint8_t shift = 0, bits = 0, scale = 0;
+        switch (kind) {
+            case 'd': shift = 0;  bits = 5; break;
+            case 'n':
+            case 'b': shift = 5;  bits = 5; break;
+            case 'm': shift = 16; bits = 5; break;
+            case 'i': shift = 10; bits = 12; scale = t->scale; break;
+            case 'h': shift = 5;  bits = 16; break;
+            case 'l':
+                retassure(op == "?", "only '?' is supported as target in \"" + src + "\"");
+                continue;
+        }
+        uint32_t fieldmask = ((1u << bits) - 1) << shift;
+
+        std::string val;
+        if (kind == 'i' || kind == 'h') {
+            retassure(op.size() > 1 && op[0] == '#', "expected immediate in \"" + src + "\"");
+            val = op.substr(1);
+        }else{
+            std::string lop = op;
+            for (auto &c : lop) c = (char)tolower(c);
+            //register 31 is sp for the base register and add/sub, zr everywhere else
+            bool isSP = (kind == 'b' || (t->sp31 && kind != 'm'));
+            if (lop == "sp" || lop == "wsp") {
+                retassure(isSP, "sp can't be encoded in \"" + src + "\"");
+                val = "31";
+            }else if (lop == "xzr" || lop == "wzr") {
+                retassure(!isSP, "zero register can't be encoded in \"" + src + "\"");
+                val = "31";
+            }else{
+                //the base register is always x, e.g. ldr w0, [x1]
+                char w = (char)tolower(op[0]);
+                retassure(op.size() > 1 && (kind == 'b' ? w == 'x' : (w == t->width || (kind == 'n' && w == 'x'))), "expected " + std::string(1,kind == 'b' ? 'x' : t->width) + " register in \"" + src + "\"");
+                val = op.substr(1);
+            }
+        }
+
+        if (val == "?") {
+            s.mask &= ~fieldmask;
+        }else if (isCapture(val)) {
+            s.mask &= ~fieldmask;
+            s.captures.push_back({shift,bits,scale,(uint8_t)(val[0]-'A')});
+        }else{
+            char *end = NULL;
+            uint64_t v = strtoull(val.c_str(), &end, 0);
+            retassure(val.size() && !*end, "bad operand \"" + op + "\" in \"" + src + "\"");
+            retassure(!(v & ((1ull << scale)-1)) && (v >> scale) < (1ull << bits), "operand \"" + op + "\" out of range in \"" + src + "\"");
+            s.mask |= fieldmask;
+            s.value = (s.value & ~fieldmask) | ((uint32_t)(v >> scale) << shift);
+        }
+    }
+    _steps.push_back(s);
+}
+
+bool pattern::match(const uint32_t *words, size_t avail, patternmatch &m) const{
+    if (avail < _steps.size())
+        return false;
+    m.captured = 0;
+    for (size_t k=0; k<_steps.size(); k++) {
+        const step &s = _steps[k];
+        uint32_t w = words[k];
+        if ((w & s.mask) != s.value)
+            return false;
+        for (auto &f : s.captures) {
+            uint64_t v = (uint64_t)((w >> f.shift) & ((1u << f.bits) - 1)) << f.scale;
+            if (m.captured & (1u << f.slot)) {
+                if (m.values[f.slot] != v)
+                    return false;
+            }else{
+                m.values[f.slot] = v;
+                m.captured |= 1u << f.slot;
+            }
+        }
+    }
+    return true;
+}
+
+loc_t pattern::next(offsetfinder64 &of, loc_t start, patternmatch *m) const{
+    const text_t *seg = of.segmentForLoc(start);
+    retassure(seg, "start not mapped");
+    patternmatch tmp;
+    if (!m) m = &tmp;
+
+    const uint32_t *words = (const uint32_t *)(seg->map + ((start - seg->base) & ~3ull));
+    size_t n = (seg->size - (start - seg->base)) / 4;
+    for (size_t k=0; k<n; k++) {
+        if (match(words+k, n-k, *m)) {
+            m->loc = seg->base + ((const uint8_t *)(words+k) - (const uint8_t *)seg->map);
+            m->pattern = 0;
+            return m->loc;
+        }
+    }
+    return 0;
+}
+
+#pragma mark patternset
+
+patternset::patternset() :
+    _buckets(0x100),
+    _prefilter(true)
+{
+    //
+}
+
+size_t patternset::add(const pattern &p){
+    size_t idx = _patterns.size();
+    _patterns.push_back(p);
+    const pattern::step &first = p.steps().front();
+    
+    bool known = false;
+    for (auto &d : _firstDefs)
+        known |= (d.mask == first.mask && d.value == first.value);
+    if (!known)
+        _firstDefs.push_back({first.mask,first.value});
+    if (!first.mask || _firstDefs.size() > kMaxPrefilterDefs)
+        _prefilter = false; //matches everywhere, or too many compares per word
+    
+    for (uint32_t b=0; b<0x100; b++) {
+        uint32_t top = b << 24;
+        if ((top & first.mask) == (first.value & first.mask & 0xFF000000))
+            _buckets[b].push_back((uint32_t)idx);
+    }
+    return idx;
+}
+
+void patternset::scan(offsetfinder64 &of, std::function<bool(const patternmatch &m)> cb) const{
+    patternmatch m;
+    for (auto &seg : of.segments()) {
+        if (!seg.isExec)
+            continue;
+        const uint32_t *words = (const uint32_t *)seg.map;
+        size_t n = seg.size / 4;
+        for (size_t blk=0; blk<n; blk+=kClassifyBlockWords) {
+            size_t cnt = std::min(n-blk, kClassifyBlockWords);
+            uint64_t candidates = (cnt == 64) ? ~0ull : ((1ull << cnt) - 1);
+            if (_prefilter) {
+                uint64_t hits[kMaxPrefilterDefs];
+                classifyBlock(words+blk, cnt, _firstDefs.data(), _firstDefs.size(), hits);
+                candidates = 0;
+                for (size_t d=0; d<_firstDefs.size(); d++)
+                    candidates |= hits[d];
+            }
+            for (; candidates; candidates &= candidates-1) {
+                size_t k = blk + __builtin_ctzll(candidates);
+                for (uint32_t idx : _buckets[words[k] >> 24]) {
+                    if (_patterns[idx].match(words+k, n-k, m)) {
+                        m.loc = seg.base + 4*k;
+                        m.pattern = idx;
+                        if (!cb(m))
+                            return;
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::vector<loc_t> patternset::first(offsetfinder64 &of) const{
+    std::vector<loc_t> ret(_patterns.size(), 0);
+    size_t missing = _patterns.size();
+    scan(of, [&](const patternmatch &m)->bool{
+        if (!ret[m.pattern]) {
+            ret[m.pattern] = m.loc;
+            missing--;
+        }
+        return missing != 0;
+    });
+    return ret;
+}
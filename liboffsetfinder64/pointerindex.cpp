@@ -0,0 +1,95 @@
+//
+//  pointerindex.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "pointerindex.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/pointerindex.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <algorithm>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+#define KERNEL_PTR_TAG          0xffff000000000000ULL
+#define CHAINED_PTR_AUTH        (1ULL<<63)
+#define CHAINED_PTR_SIGNEXT_BIT (1ULL<<50)
+
+//DYLD_CHAINED_PTR_64_KERNEL_CACHE: target:30 cacheLevel:2 diversity:16 addrDiv:1 key:2 next:12 isAuth:1
+#define KC_TARGET(v)            ((v) & 0x3fffffffULL)
+#define KC_CACHE_LEVEL(v)       (((v) >> 30) & 3)
+#define KC_AUTH_BITS(v)         (((v) >> 32) & 0x7ffff)     //diversity, addrDiv, key
+#define KC_NEXT(v)              (((v) >> 51) & 0xfff)
+
+pointerindex::pointerindex(offsetfinder64 &of) :
+    _base(of.find_base()),
+    _vmBase(of.vmBase()),
+    _vmEnd(of.vmEnd())
+{
+    build(of);
+}
+
+loc_t pointerindex::normalize(uint64_t v) const{
+    uint64_t ptr = 0;
+    if ((v & KERNEL_PTR_TAG) == KERNEL_PTR_TAG) {
+        //plain pointer
+        ptr = v;
+    }else if (v & CHAINED_PTR_AUTH) {
+        //authenticated kernel cache rebase, 30 bit target offset from the kernel base
+        if (KC_CACHE_LEVEL(v))
+            return 0;
+        ptr = (uint64_t)_base + KC_TARGET(v);
+    }else if (v & CHAINED_PTR_SIGNEXT_BIT) {
+        //thread starts rebase, low 51 bits are the sign extended pointer
+        ptr = v | ~((1ULL<<51)-1);
+    }else if (KC_NEXT(v) && !KC_CACHE_LEVEL(v) && !KC_AUTH_BITS(v)) {
+        //plain kernel cache rebase. Without a next delta it can't be told apart from a small integer
+        ptr = (uint64_t)_base + KC_TARGET(v);
+    }else{
+        return 0;
+    }
+    
+    if (ptr < (uint64_t)_vmBase || ptr >= (uint64_t)_vmEnd)
+        return 0;
+    return (loc_t)ptr;
+}
+
+void pointerindex::build(offsetfinder64 &of){
+    for (auto &seg : of.segments()) {
+        if (seg.isExec || !seg.size)
+            continue;
+        const uint64_t *words = (const uint64_t *)of.rebasedMemoryForLoc(seg.base, seg.size);
+        if (!words)
+            continue;
+        size_t cnt = seg.size / sizeof(uint64_t);
+        for (size_t i=0; i<cnt; i++) {
+            loc_t target = normalize(words[i]);
+            if (target && of.segmentForLoc(target))
+                _refs.push_back({target, seg.base + i*sizeof(uint64_t)});
+        }
+    }
+    std::sort(_refs.begin(), _refs.end(), [](const xref &a, const xref &b){
+        return a.target < b.target || (a.target == b.target && a.location < b.location);
+    });
+}
+
+std::pair<const pointerindex::xref*, const pointerindex::xref*> pointerindex::refsTo(loc_t target) const{
+    auto lo = std::lower_bound(_refs.begin(), _refs.end(), target, [](const xref &a, loc_t t){
+        return a.target < t;
+    });
+    auto hi = lo;
+    while (hi != _refs.end() && hi->target == target)
+        ++hi;
+    const xref *base = _refs.data();
+    return {base + (lo - _refs.begin()), base + (hi - _refs.begin())};
+}
+
+loc_t pointerindex::firstRefTo(loc_t target) const{
+    auto refs = refsTo(target);
+    return (refs.first != refs.second) ? refs.first->location : 0;
+}
@@ -0,0 +1,293 @@
+//
+//  porting.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "porting.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/porting.hpp>
+#include <liboffsetfinder64/batch.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
+#include <string.h>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+#define FNV_PRIME 0x100000001b3ULL
+#define FNV_BASIS 0xcbf29ce484222325ULL
+
+//word with all fields masked which change when code or data moves
+static uint32_t maskRelocated(uint32_t w, uint32_t prev){
+    if ((w & 0x1F000000) == 0x10000000) return w & 0x9F00001F; //adrp, adr
+    if ((w & 0x7C000000) == 0x14000000) return w & 0xFC000000; //b, bl
+    if ((w & 0xFF000010) == 0x54000000) return w & 0xFF00001F; //b.cond
+    if ((w & 0x7E000000) == 0x34000000) return w & 0xFF00001F; //cbz, cbnz
+    if ((w & 0x7E000000) == 0x36000000) return w & 0xFFF8001F; //tbz, tbnz
+    if ((w & 0x3B000000) == 0x18000000) return w & 0xFF00001F; //ldr (literal)
+    if ((prev & 0x9F000000) == 0x90000000 && ((w >> 5) & 0x1f) == (prev & 0x1f)) {
+        //page offset of the preceding adrp
+        if ((w & 0x7F800000) == 0x11000000) return w & 0xFFC003FF; //add (immediate)
+        if ((w & 0x3B000000) == 0x39000000) return w & 0xFFC003FF; //ldr/str (unsigned offset)
+    }
+    return w;
+}
+
+static uint64_t adrpPage(loc_t pc, uint32_t w){
+    int64_t imm = (int64_t)((((w >> 5) & 0x7FFFF) << 2) | ((w >> 29) & 3));
+    imm = (imm << 43) >> 43; //sign extend 21 bits
+    return ((uint64_t)pc & ~0xfffULL) + (imm << 12);
+}
+
+#pragma mark fingerprints
+
+fingerprints::fingerprints(offsetfinder64 &of){
+    const std::vector<loc_t> &starts = of.callGraph().functions();
+    cstringindex &strs = of.cstrings();
+
+    for (size_t i=0; i<starts.size(); i++) {
+        loc_t start = starts[i];
+        const text_t *seg = of.segmentForLoc(start);
+        if (!seg || !seg->isExec || ((uint64_t)start & 3))
+            continue;
+        loc_t end = seg->base + seg->size;
+        if (i+1 < starts.size() && starts[i+1] < end)
+            end = starts[i+1];
+        size_t n = std::min<size_t>((end - start)/4, kMaxFunctionInsns);
+        const uint32_t *words = (const uint32_t *)(seg->map + (start - seg->base));
+
+        function f = {start,(uint32_t)n,0,0,FNV_BASIS,0};
+        uint32_t prev = 0;
+        for (size_t k=0; k<n; k++) {
+            uint32_t w = words[k];
+            uint32_t m = maskRelocated(w, prev);
+            for (int b=0; b<4; b++)
+                f.code = (f.code ^ ((m >> (8*b)) & 0xff)) * FNV_PRIME;
+
+            if ((w & 0xFC000000) == 0x94000000)
+                f.calls++;
+            else if ((w & 0xFC000000) == 0x14000000 || (w & 0xFF000010) == 0x54000000 || (w & 0x7C000000) == 0x34000000)
+                f.branches++; //b, b.cond, cbz/cbnz/tbz/tbnz
+
+            if ((prev & 0x9F000000) == 0x90000000 && (w & 0xFFC00000) == 0x91000000 && ((w >> 5) & 0x1f) == (prev & 0x1f)) {
+                //adrp + add x, referenced string
+                loc_t target = (loc_t)(adrpPage(start + 4*(k-1), prev) + ((w >> 10) & 0xfff));
+                size_t len = 0;
+                if (const char *str = strs.stringAt(target, &len))
+                    f.strings = (f.strings ^ cstringindex::hash(str, len)) * FNV_PRIME;
+            }
+            prev = w;
+        }
+        _functions.push_back(f);
+    }
+}
+
+const fingerprints::function *fingerprints::functionFor(loc_t pc) const{
+    auto it = std::upper_bound(_functions.begin(), _functions.end(), pc, [](loc_t p, const function &f){
+        return p < f.start;
+    });
+    if (it == _functions.begin())
+        return NULL;
+    const function &f = *(it-1);
+    return (pc < f.start + 4*(uint64_t)f.insns) ? &f : NULL;
+}
+
+void fingerprints::save(FILE *f) const{
+    for (auto &fn : _functions) {
+        fprintf(f, "F %llx %u %u %u %016llx %016llx\n",(unsigned long long)fn.start,fn.insns,fn.calls,fn.branches,
+                (unsigned long long)fn.code,(unsigned long long)fn.strings);
+    }
+}
+
+bool fingerprints::loadLine(const char *line){
+    unsigned long long start = 0, code = 0, strings = 0;
+    function fn = {};
+    if (sscanf(line, "F %llx %u %u %u %llx %llx",&start,&fn.insns,&fn.calls,&fn.branches,&code,&strings) != 6)
+        return false;
+    fn.start = (loc_t)start;
+    fn.code = code;
+    fn.strings = strings;
+    retassure(_functions.empty() || _functions.back().start < fn.start, "fingerprints not sorted");
+    _functions.push_back(fn);
+    return true;
+}
+
+#pragma mark offsetporter
+
+static uint64_t exactKey(const fingerprints::function &f){
+    return ((f.code * FNV_PRIME) ^ f.strings) * FNV_PRIME ^ f.insns;
+}
+
+offsetporter::offsetporter(const fingerprints &from, const fingerprints &to) :
+    _from(from),
+    _to(to),
+    _exact(0)
+{
+    //key -> function, NULL if the key isn't unique
+    auto uniques = [](const fingerprints &prints, uint64_t (*key)(const fingerprints::function &f)){
+        std::unordered_map<uint64_t,const fingerprints::function*> ret;
+        for (auto &f : prints.functions()) {
+            auto ins = ret.insert({key(f),&f});
+            if (!ins.second)
+                ins.first->second = NULL;
+        }
+        return ret;
+    };
+    auto stringsKey = [](const fingerprints::function &f)->uint64_t{return f.strings;};
+
+    auto toExact = uniques(to, exactKey);
+    auto fromExact = uniques(from, exactKey);
+    auto toStrings = uniques(to, stringsKey);
+    auto fromStrings = uniques(from, stringsKey);
+
+    std::vector<bool> used(to.functions().size(), false);
+    std::vector<const fingerprints::function*> fuzzy;
+    for (auto &f : from.functions()) {
+        auto it = toExact.find(exactKey(f));
+        if (it != toExact.end() && it->second && fromExact[exactKey(f)]) {
+            _matches.push_back({&f,it->second,true});
+            used[it->second - to.functions().data()] = true;
+            _exact++;
+        }else if (f.strings) {
+            fuzzy.push_back(&f);
+        }
+    }
+    for (auto f : fuzzy) {
+        auto it = toStrings.find(f->strings);
+        if (it == toStrings.end() || !it->second || !fromStrings[f->strings] || used[it->second - to.functions().data()])
+            continue;
+        used[it->second - to.functions().data()] = true;
+        _matches.push_back({f,it->second,false});
+    }
+    std::sort(_matches.begin(), _matches.end(), [](const match &lhs, const match &rhs){
+        return lhs.from->start < rhs.from->start;
+    });
+}
+
+const offsetporter::match *offsetporter::matchFor(loc_t from) const{
+    const fingerprints::function *f = _from.functionFor(from);
+    if (!f)
+        return NULL;
+    auto it = std::lower_bound(_matches.begin(), _matches.end(), f->start, [](const match &m, loc_t s){
+        return m.from->start < s;
+    });
+    return (it != _matches.end() && it->from == f) ? &*it : NULL;
+}
+
+loc_t offsetporter::port(loc_t loc) const{
+    const match *m = matchFor(loc);
+    if (!m || !m->exact)
+        return 0;
+    return m->to->start + (loc - m->from->start);
+}
+
+static bool parseHexField(const std::string &json, const char *key, size_t from, std::string &value){
+    size_t pos = json.find(std::string("\"") + key + "\":\"", from);
+    if (pos == std::string::npos)
+        return false;
+    pos += strlen(key) + 4;
+    size_t end = json.find('"', pos);
+    if (end == std::string::npos)
+        return false;
+    value = json.substr(pos, end-pos);
+    return true;
+}
+
+bool offsetporter::portResult(const std::string &json, uint64_t slide, std::string &ported) const{
+    return relocateResult(json, [this](loc_t loc){return port(loc);}, slide, ported);
+}
+
+bool patchfinder64::relocateResult(const std::string &json, const std::function<loc_t(loc_t)> &relocate, uint64_t slide, std::string &relocated){
+    if (json.size() > 2 && json[0] == '"') {
+        //address
+        loc_t loc = relocate((loc_t)strtoull(json.c_str()+1, NULL, 16));
+        if (!loc)
+            return false;
+        relocated = jsonLoc(loc + slide);
+        return true;
+    }
+    if (json.size() && (json[0] == '{' || json[0] == '[')) {
+        //patch or list of patches
+        std::string ret;
+        size_t pos = 0;
+        while ((pos = json.find('{', pos)) != std::string::npos) {
+            std::string location, bytes;
+            if (!parseHexField(json, "location", pos, location) || !parseHexField(json, "patch", pos, bytes))
+                return false;
+            loc_t loc = relocate((loc_t)strtoull(location.c_str(), NULL, 16));
+            if (!loc)
+                return false;
+            if (bytes.size() == 16) {
+                //pointer sized content, if it points into the kernel it has to be relocated too
+                uint64_t v = 0;
+                for (int i=7; i>=0; i--)
+                    v = (v << 8) | strtoul(bytes.substr(2*i,2).c_str(), NULL, 16);
+                if ((v >> 48) == 0xffff) {
+                    loc_t dst = relocate((loc_t)v);
+                    if (!dst)
+                        return false;
+                    v = (uint64_t)dst + slide;
+                    char buf[3];
+                    bytes.clear();
+                    for (int i=0; i<8; i++, v >>= 8) {
+                        snprintf(buf, sizeof(buf), "%02x", (unsigned)(v & 0xff));
+                        bytes += buf;
+                    }
+                }
+            }
+            if (ret.size())
+                ret += ",";
+            ret += "{\"location\":" + jsonLoc(loc + slide) + ",\"patch\":\"" + bytes + "\"}";
+            pos = json.find('}', pos);
+            if (pos == std::string::npos)
+                return false;
+        }
+        if (json[0] == '[')
+            ret = "[" + ret + "]";
+        else if (ret.empty())
+            return false;
+        relocated = ret;
+        return true;
+    }
+    return false; //plain numbers don't say which function they came from
+}
+
+#pragma mark analysis
+
+void analysis::save(const char *path) const{
+    FILE *f = fopen(path, "w");
+    retassure(f, std::string("failed to open ") + path);
+    prints.save(f);
+    for (auto &r : results)
+        fprintf(f, "R %s %s\n",r.first.c_str(),r.second.c_str());
+    fclose(f);
+}
+
+void analysis::load(const char *path){
+    //loadLine throws on unsorted fingerprints
+    std::unique_ptr<FILE, int(*)(FILE*)> f(fopen(path, "r"), fclose);
+    retassure(f, std::string("failed to open ") + path);
+    std::string line;
+    char buf[0x400];
+    while (fgets(buf, sizeof(buf), f.get())) {
+        line += buf;
+        if (line.back() != '\n' && !feof(f.get()))
+            continue; //longer than buf
+        if (line.back() == '\n')
+            line.pop_back();
+        if (line[0] == 'F') {
+            prints.loadLine(line.c_str());
+        }else if (line[0] == 'R' && line[1] == ' ') {
+            size_t sp = line.find(' ', 2);
+            if (sp != std::string::npos)
+                results[line.substr(2, sp-2)] = line.substr(sp+1);
+        }
+        line.clear();
+    }
+}
@@ -0,0 +1,312 @@
+//
+//  regtracker.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "regtracker.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/regtracker.hpp>
+#include <liboffsetfinder64/cfg.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <algorithm>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+#define REG_SP_ZR 31
+#define CALL_CLOBBERED_REGS 0x4007FFFF //x0-x18, lr
+
+#pragma mark helpers
+static inline int64_t sext(uint64_t v, int bits){
+    return (int64_t)(v << (64-bits)) >> (64-bits);
+}
+
+static inline uint64_t regmask(uint32_t i, uint64_t v){
+    return (i>>31) ? v : (v & 0xffffffff);
+}
+
+uint32_t regtracker::writemask(uint32_t i){
+    uint64_t target = 0;
+    switch (cfg::branchInfo(i, 0, target)) {
+        case cfg::kBranchCall:
+        case cfg::kBranchIndirectCall:
+            return CALL_CLOBBERED_REGS;
+        case cfg::kNoBranch:
+            break;
+        default:
+            return 0;
+    }
+
+    if ((i & 0xFF000000) == 0xD4000000) //exception generation
+        return 0;
+    if ((i & 0xFFC00000) == 0xD5000000) //system, only MRS/SYSL write a register
+        return (BIT_AT(i, 21)) ? (1 << BIT_RANGE(i, 0, 4)) : 0;
+
+    if ((i & 0x0A000000) == 0x08000000) {
+        //loads and stores
+        uint32_t ret = 0;
+        bool vector = BIT_AT(i, 26);
+        bool pair = BIT_RANGE(i, 27, 29) == 0b101;
+        bool exclusive = BIT_RANGE(i, 24, 29) == 0b001000;
+        bool literal = BIT_RANGE(i, 27, 29) == 0b011 && !BIT_AT(i, 24);
+        bool anysingle = BIT_RANGE(i, 27, 29) == 0b111;
+        bool single = anysingle && !BIT_AT(i, 24);
+        bool atomic = single && BIT_AT(i, 21) && BIT_RANGE(i, 10, 11) == 0;
+        bool load = literal || (anysingle ? BIT_RANGE(i, 22, 23) != 0 : BIT_AT(i, 22));
+
+        if (exclusive)
+            ret |= (1 << BIT_RANGE(i, 16, 20)) | (1 << BIT_RANGE(i, 0, 4));
+        else if (!vector && (load || atomic))
+            ret |= (1 << BIT_RANGE(i, 0, 4));
+        if (!vector && pair && load)
+            ret |= (1 << BIT_RANGE(i, 10, 14));
+
+        //writeback to base register
+        if ((pair && BIT_AT(i, 23)) || (single && !BIT_AT(i, 21) && BIT_AT(i, 10)))
+            ret |= (1 << BIT_RANGE(i, 5, 9));
+        return ret;
+    }
+
+    //everything else is assumed to write Rd
+    return 1 << BIT_RANGE(i, 0, 4);
+}
+
+#pragma mark regtracker
+regtracker::regtracker(offsetfinder64 &of, const cfg &g) :
+    _of(of),
+    _start(g.start()),
+    _end(g.end())
+{
+    build(g);
+}
+
+bool regtracker::derefmem(uint64_t addr, int size, uint64_t &val){
+    const void *mem = _of.rebasedMemoryForLoc((loc_t)addr, size);
+    if (!mem)
+        return false;
+    val = 0;
+    memcpy(&val, mem, size);
+    return true;
+}
+
+void regtracker::step(uint32_t i, loc_t pc, regstate &s){
+    uint8_t rd = BIT_RANGE(i, 0, 4);
+    uint8_t rn = BIT_RANGE(i, 5, 9);
+    uint8_t rm = BIT_RANGE(i, 16, 20);
+    
+    //sources need to be read before the destination gets invalidated
+    uint32_t srcknown = s.known;
+    uint64_t vrd = s.value[rd], vrn = s.value[rn], vrm = s.value[rm];
+    
+    uint32_t written = writemask(i);
+    s.known &= ~written;
+    s.loaded &= ~written;
+
+#define SETREG(r,v) do { if ((r) != REG_SP_ZR) { s.value[(r)] = (v); s.known |= 1 << (r); } } while(0)
+#define ISKNOWN(r) ((srcknown >> (r)) & 1)
+
+    if (insn::is_adrp(i)) {
+        SETREG(rd, ((uint64_t)pc & ~0xfffULL) + (sext((BIT_RANGE(i, 5, 23)<<2) | BIT_RANGE(i, 29, 30), 21) << 12));
+    }else if (insn::is_adr(i)) {
+        SETREG(rd, (uint64_t)pc + sext((BIT_RANGE(i, 5, 23)<<2) | BIT_RANGE(i, 29, 30), 21));
+    }else if (insn::is_add(i)) {
+        //ADD/ADDS/SUB/SUBS (immediate)
+        if (BIT_AT(i, 29) && rd == REG_SP_ZR)
+            return; //cmp/cmn
+        if (rn != REG_SP_ZR && ISKNOWN(rn)) {
+            uint64_t imm = BIT_RANGE(i, 10, 21) << (BIT_AT(i, 22) * 12);
+            uint64_t v = BIT_AT(i, 30) ? vrn - imm : vrn + imm;
+            SETREG(rd, regmask(i, v));
+        }
+    }else if (insn::is_movz(i) || BIT_RANGE(i, 23, 30) == 0b00100101 /*movn*/) {
+        uint64_t v = (uint64_t)BIT_RANGE(i, 5, 20) << (BIT_RANGE(i, 21, 22)*16);
+        if (!insn::is_movz(i))
+            v = ~v;
+        SETREG(rd, regmask(i, v));
+    }else if (insn::is_movk(i)) {
+        if (ISKNOWN(rd)) {
+            int shift = BIT_RANGE(i, 21, 22)*16;
+            uint64_t v = (vrd & ~(0xffffULL << shift)) | ((uint64_t)BIT_RANGE(i, 5, 20) << shift);
+            SETREG(rd, regmask(i, v));
+        }
+    }else if (insn::is_orr(i) || insn::is_and(i)) {
+        bool isorr = insn::is_orr(i);
+        if (rn == REG_SP_ZR || ISKNOWN(rn)) {
+            uint64_t src = (rn == REG_SP_ZR) ? 0 : vrn;
+            uint64_t imm = insn::decode_logical_imm(i);
+            SETREG(rd, regmask(i, isorr ? (src | imm) : (src & imm)));
+        }
+    }else if ((i & 0x7FE0FFE0) == 0x2A0003E0) {
+        //mov (register)
+        if (rm == REG_SP_ZR)
+            SETREG(rd, 0);
+        else if (ISKNOWN(rm))
+            SETREG(rd, regmask(i, vrm));
+    }else if ((i & 0x3FC00000) == 0x39400000 || (i & 0x3FE00C00) == 0x38400000 || (i & 0xBF000000) == 0x18000000) {
+        //LDR{B,H,,} (unsigned offset), LDUR{B,H,,} and LDR (literal)
+        uint64_t addr = 0;
+        int size = 0;
+        bool haveaddr = false;
+        if ((i & 0xBF000000) == 0x18000000) {
+            size = BIT_AT(i, 30) ? 8 : 4;
+            addr = (uint64_t)pc + (sext(BIT_RANGE(i, 5, 23), 19) << 2);
+            haveaddr = true;
+        }else{
+            size = 1 << BIT_RANGE(i, 30, 31);
+            if (rn != REG_SP_ZR && ISKNOWN(rn)) {
+                if (BIT_AT(i, 24))
+                    addr = vrn + BIT_RANGE(i, 10, 21) * size;
+                else
+                    addr = vrn + sext(BIT_RANGE(i, 12, 20), 9);
+                haveaddr = true;
+            }
+        }
+        if (haveaddr && rd != REG_SP_ZR) {
+            uint64_t v = 0;
+            s.loadaddr[rd] = addr;
+            s.loaded |= 1 << rd;
+            if (derefmem(addr, size, v))
+                SETREG(rd, v);
+        }
+    }
+
+#undef ISKNOWN
+#undef SETREG
+}
+
+size_t regtracker::blockIndex(loc_t pc) const{
+    auto it = std::upper_bound(_blocks.begin(), _blocks.end(), pc, [](loc_t p, const block &b){
+        return p < b.start;
+    });
+    retassure(it != _blocks.begin(), "pc not in function");
+    return (it - _blocks.begin()) - 1;
+}
+
+void regtracker::build(const cfg &g){
+    const text_t *seg = _of.segmentForLoc(_start);
+    const uint32_t *words = (const uint32_t *)(seg->map + (_start - seg->base));
+    const std::vector<cfg::block> &gblocks = g.blocks();
+
+    _blocks.clear();
+    for (auto &gb : gblocks) {
+        block b;
+        b.start = gb.start;
+        b.reachable = false;
+        b.loopclobber = 0;
+        memset(&b.in, 0, sizeof(b.in));
+        _blocks.push_back(b);
+    }
+
+    std::vector<std::pair<size_t, size_t>> backedges; //target block, source block
+    for (size_t bi=0; bi<gblocks.size(); bi++) {
+        auto preds = g.predecessors(bi);
+        for (const cfg::edge *e = preds.first; e != preds.second; e++) {
+            if (e->block >= bi)
+                backedges.push_back({bi,e->block});
+        }
+    }
+
+    //registers written anywhere a loop can reach before branching back invalidate the loop head
+    for (auto &be : backedges) {
+        size_t ext = be.second;
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t bi=be.first; bi<=ext; bi++) {
+                auto succs = g.successors(bi);
+                for (const cfg::edge *e = succs.first; e != succs.second; e++) {
+                    if (e->block > ext) {
+                        ext = e->block;
+                        changed = true;
+                    }
+                }
+            }
+            for (auto &o : backedges) {
+                if (o.first >= be.first && o.first <= ext && o.second > ext) {
+                    ext = o.second;
+                    changed = true;
+                }
+            }
+        }
+        uint32_t clobber = 0;
+        for (loc_t pc = gblocks[be.first].start; pc < gblocks[ext].end; pc+=4)
+            clobber |= writemask(words[(pc - _start)/4]);
+        _blocks[be.first].loopclobber |= clobber;
+    }
+
+    auto mergeInto = [&](size_t bi, const regstate &s){
+        block &b = _blocks[bi];
+        if (!b.reachable) {
+            b.in = s;
+            b.reachable = true;
+            return;
+        }
+        uint32_t eqv = 0, eqa = 0;
+        for (int r=0; r<32; r++) {
+            if (b.in.value[r] == s.value[r]) eqv |= 1 << r;
+            if (b.in.loadaddr[r] == s.loadaddr[r]) eqa |= 1 << r;
+        }
+        b.in.known &= s.known & eqv;
+        b.in.loaded &= s.loaded & eqa;
+    };
+
+    _blocks[0].reachable = true;
+    for (size_t bi=0; bi<_blocks.size(); bi++) {
+        block &b = _blocks[bi];
+        if (!b.reachable) {
+            //only reachable through something we can't see (jumptables, noreturn calls)
+            b.in.known = b.in.loaded = 0;
+            b.reachable = true;
+        }
+        b.in.known &= ~b.loopclobber;
+        b.in.loaded &= ~b.loopclobber;
+
+        regstate s = b.in;
+        for (loc_t pc = b.start; pc < gblocks[bi].end; pc+=4)
+            step(words[(pc - _start)/4], pc, s);
+
+        auto succs = g.successors(bi);
+        for (const cfg::edge *e = succs.first; e != succs.second; e++) {
+            if (e->block > bi)
+                mergeInto(e->block, s);
+        }
+    }
+}
+
+#pragma mark queries
+regtracker::regstate regtracker::stateAt(loc_t pc){
+    retassure(pc >= _start && pc < _end, "pc not in function");
+    const block &b = _blocks[blockIndex(pc)];
+    regstate s = b.in;
+    const text_t *seg = _of.segmentForLoc(_start);
+    for (loc_t p = b.start; p < pc; p+=4) {
+        step(*(uint32_t*)(seg->map + (p - seg->base)), p, s);
+    }
+    return s;
+}
+
+bool regtracker::value(loc_t pc, int reg, uint64_t *val){
+    regstate s = stateAt(pc);
+    if (!((s.known >> reg) & 1))
+        return false;
+    if (val) *val = s.value[reg];
+    return true;
+}
+
+bool regtracker::loadAddress(loc_t pc, int reg, loc_t *addr){
+    regstate s = stateAt(pc);
+    if (!((s.loaded >> reg) & 1))
+        return false;
+    if (addr) *addr = (loc_t)s.loadaddr[reg];
+    return true;
+}
+
+uint64_t regtracker::valueAt(loc_t pc, int reg){
+    uint64_t ret = 0;
+    retassure(value(pc, reg, &ret), "register value unknown at pc");
+    return ret;
+}
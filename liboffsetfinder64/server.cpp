@@ -0,0 +1,309 @@
+//
+//  server.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "server.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/server.hpp>
+#include <liboffsetfinder64/slideview.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <poll.h>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <sstream>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+#define SERVER_MAX_LINE 0x1000
+#define SERVER_BACKLOG 16
+#define SERVER_POLL_MS 200
+
+static void fillSockaddr(const std::string &path, struct sockaddr_un &addr){
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    retassure(path.size() < sizeof(addr.sun_path), "socket path too long");
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
+}
+
+static bool writeAll(int fd, const std::string &str){
+    size_t done = 0;
+    while (done < str.size()) {
+        ssize_t w = write(fd, str.data() + done, str.size() - done);
+        if (w <= 0)
+            return false;
+        done += w;
+    }
+    return true;
+}
+
+offsetserver::offsetserver(const std::string &socketPath, unsigned threads, size_t cacheSize) :
+    _path(socketPath),
+    _listenfd(-1),
+    _cacheSize(cacheSize ? cacheSize : 1),
+    _pool(threads),
+    _stop(false),
+    _connections(0),
+    _requests(0), _failed(0), _hits(0), _misses(0),
+    _latencyTotalUs(0), _latencyMaxUs(0)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    fillSockaddr(_path, addr);
+    memset(&st, 0, sizeof(st));
+    //only called on failure, the destructor doesn't run if the constructor throws
+    auto clean =[&]{
+        close(_listenfd);
+        _listenfd = -1;
+    };
+    
+    retassure((_listenfd = socket(AF_UNIX, SOCK_STREAM, 0)) != -1, "failed to create socket");
+    if (!lstat(_path.c_str(), &st)) {
+        //only replace a stale socket, never whatever else lives at that path
+        if (!S_ISSOCK(st.st_mode)) {
+            clean();
+            reterror("refusing to replace " + _path + ", not a socket");
+        }
+        unlink(_path.c_str());
+    }
+    if (bind(_listenfd, (struct sockaddr *)&addr, sizeof(addr))) {
+        clean();
+        reterror("failed to bind " + _path);
+    }
+    //nobody can connect before listen, so the socket is never reachable with the umask's permissions
+    if (chmod(_path.c_str(), S_IRUSR | S_IWUSR) || listen(_listenfd, SERVER_BACKLOG)) {
+        clean();
+        unlink(_path.c_str());
+        reterror("failed to listen on " + _path);
+    }
+}
+
+offsetserver::~offsetserver(){
+    if (_listenfd != -1) {
+        close(_listenfd);
+        unlink(_path.c_str());
+    }
+}
+
+void offsetserver::stop(){
+    _stop = true;
+}
+
+void offsetserver::serve(){
+    while (!_stop) {
+        struct pollfd pfd = {_listenfd, POLLIN, 0};
+        if (poll(&pfd, 1, SERVER_POLL_MS) <= 0)
+            continue;
+        int fd = accept(_listenfd, NULL, NULL);
+        if (fd == -1)
+            continue;
+        //idle connections only hold their own thread, the pool is kept for requests
+        {
+            std::unique_lock<std::mutex> l(_connLock);
+            _connections++;
+        }
+        try {
+            std::thread([this, fd]{
+                handleConnection(fd);
+                std::unique_lock<std::mutex> l(_connLock);
+                if (!--_connections)
+                    _connCond.notify_all();
+            }).detach();
+        } catch (std::exception &e) {
+            close(fd);
+            std::unique_lock<std::mutex> l(_connLock);
+            _connections--;
+        }
+    }
+    //connections see _stop within SERVER_POLL_MS
+    std::unique_lock<std::mutex> l(_connLock);
+    _connCond.wait(l, [this]{return !_connections;});
+}
+
+void offsetserver::handleConnection(int fd){
+    std::string buf;
+    char tmp[0x400];
+    
+    while (!_stop) {
+        size_t nl = buf.find('\n');
+        if (nl == std::string::npos) {
+            if (buf.size() > SERVER_MAX_LINE)
+                break;
+            struct pollfd pfd = {fd, POLLIN, 0};
+            int pr = poll(&pfd, 1, SERVER_POLL_MS);
+            if (pr == 0)
+                continue;
+            ssize_t r = (pr > 0) ? read(fd, tmp, sizeof(tmp)) : -1;
+            if (r <= 0)
+                break;
+            buf.append(tmp, r);
+            continue;
+        }
+        std::string line = buf.substr(0, nl);
+        buf.erase(0, nl+1);
+        if (line.size() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            continue;
+        std::promise<std::string> reply;
+        _pool.push([this, &line, &reply]{reply.set_value(handleRequest(line));});
+        if (!writeAll(fd, reply.get_future().get() + "\n"))
+            break;
+    }
+    close(fd);
+}
+
+offsetserver::kernelentry offsetserver::kernel(const std::string &path, bool &cached){
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    retassure(!stat(path.c_str(), &st), "failed to stat " + path);
+    
+    {
+        std::unique_lock<std::mutex> l(_cacheLock);
+        auto pit = _byPath.find(path);
+        if (pit != _byPath.end() && pit->second.mtime == st.st_mtime && pit->second.size == st.st_size) {
+            auto kit = _byKey.find(pit->second.key);
+            if (kit != _byKey.end()) {
+                _lru.splice(_lru.begin(), _lru, kit->second);
+                cached = true;
+                return *kit->second;
+            }
+        }
+    }
+    
+    //load outside of the cache lock, other kernels stay available meanwhile
+    kernelentry e;
+    e.fi = std::shared_ptr<offsetfinder64>(new offsetfinder64(path.c_str()));
+    e.key = e.fi->uuid();
+    if (e.key.empty())
+        e.key = path;
+    
+    std::unique_lock<std::mutex> l(_cacheLock);
+    _byPath[path] = {e.key, st.st_mtime, st.st_size};
+    auto kit = _byKey.find(e.key);
+    if (kit != _byKey.end()) {
+        //same kernel under another path, or loaded concurrently
+        _lru.splice(_lru.begin(), _lru, kit->second);
+        cached = true;
+        return *kit->second;
+    }
+    
+    _lru.push_front(e);
+    _byKey[e.key] = _lru.begin();
+    while (_lru.size() > _cacheSize) {
+        _byKey.erase(_lru.back().key);
+        _lru.pop_back();
+    }
+    cached = false;
+    return e;
+}
+
+std::string offsetserver::handleRequest(const std::string &line){
+    auto start = std::chrono::steady_clock::now();
+    std::istringstream ss(line);
+    std::string cmd;
+    ss >> cmd;
+    
+    std::string ret;
+    bool ok = true;
+    bool cached = false;
+    
+    if (cmd == "stats") {
+        std::unique_lock<std::mutex> l(_statsLock);
+        char buf[0x100];
+        snprintf(buf, sizeof(buf), "{\"requests\":%llu,\"failed\":%llu,\"cache_hits\":%llu,\"cache_misses\":%llu,\"latency_avg_us\":%llu,\"latency_max_us\":%llu}",
+                 (unsigned long long)_requests, (unsigned long long)_failed, (unsigned long long)_hits, (unsigned long long)_misses,
+                 (unsigned long long)(_requests ? _latencyTotalUs/_requests : 0), (unsigned long long)_latencyMaxUs);
+        return buf;
+    }else if (cmd == "shutdown") {
+        _stop = true;
+        return "{\"shutdown\":true}";
+    }else if (cmd == "find") {
+        std::string path, names, slidestr;
+        ss >> path >> names >> slidestr;
+        try {
+            retassure(path.size() && names.size(), "usage: find <kernelpath> <finder>[,<finder>...] [slide]");
+            char *slideend = NULL;
+            uint64_t slide = slidestr.size() ? strtoull(slidestr.c_str(), &slideend, 0) : 0;
+            retassure(!slideend || !*slideend, "invalid slide " + slidestr);
+            kernelentry e = kernel(path, cached);
+            slideview view(*e.fi, slide);
+            
+            std::string results, errors;
+            size_t pos = 0;
+            while (pos <= names.size()) {
+                size_t end = names.find(',', pos);
+                if (end == std::string::npos) end = names.size();
+                std::string name = names.substr(pos, end-pos);
+                pos = end+1;
+                if (name.empty())
+                    continue;
+                
+                std::string res;
+                const finder *f = finderNamed(name);
+                if (!f) {
+                    res = "unknown finder";
+                }else if (runFinder(f, view, res)) {
+                    results += (results.size() ? "," : "") + jsonString(name) + ":" + res;
+                    continue;
+                }
+                errors += (errors.size() ? "," : "") + jsonString(name) + ":" + jsonString(res);
+                ok = false;
+            }
+            ret = "{\"kernel\":" + jsonString(path) + ",\"key\":" + jsonString(e.key) + ",\"cached\":" + (cached ? "true" : "false") + ",\"slide\":" + jsonLoc((loc_t)slide)
+                + ",\"results\":{" + results + "},\"errors\":{" + errors + "}";
+        } catch (tihmstar::exception &e) {
+            ret = "{\"error\":" + jsonString(e.what());
+            ok = false;
+        } catch (std::exception &e) {
+            ret = "{\"error\":" + jsonString(e.what());
+            ok = false;
+        } catch (...) {
+            ret = "{\"error\":" + jsonString("unknown error");
+            ok = false;
+        }
+    }else{
+        ret = "{\"error\":" + jsonString("unknown command " + cmd);
+        ok = false;
+    }
+    
+    uint64_t us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    {
+        std::unique_lock<std::mutex> l(_statsLock);
+        _requests++;
+        if (!ok) _failed++;
+        if (cmd == "find") (cached ? _hits : _misses)++;
+        _latencyTotalUs += us;
+        if (us > _latencyMaxUs) _latencyMaxUs = us;
+    }
+    return ret + ",\"latency_us\":" + std::to_string(us) + "}";
+}
+
+std::string offsetserver::request(const std::string &socketPath, const std::string &line){
+    struct sockaddr_un addr;
+    fillSockaddr(socketPath, addr);
+    
+    int fd = -1;
+    retassure((fd = socket(AF_UNIX, SOCK_STREAM, 0)) != -1, "failed to create socket");
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) || !writeAll(fd, line + "\n")) {
+        close(fd);
+        reterror("failed to send request to " + socketPath);
+    }
+    
+    std::string ret;
+    char c = 0;
+    while (read(fd, &c, 1) == 1 && c != '\n')
+        ret += c;
+    close(fd);
+    return ret;
+}
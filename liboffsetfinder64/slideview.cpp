@@ -0,0 +1,36 @@
+//
+//  slideview.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "slideview.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/slideview.hpp>
+#include "all_liboffsetfinder.hpp"
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+std::vector<patch> slideview::slid(const std::vector<patch> &patches) const{
+    std::vector<patch> ret;
+    ret.reserve(patches.size());
+    for (auto &p : patches)
+        ret.push_back(p.rebased(_slide));
+    return ret;
+}
+
+loc_t slideview::find(loc_t (offsetfinder64::*f)()) const{
+    return slid((_of.*f)());
+}
+
+patch slideview::find(patch (offsetfinder64::*f)()) const{
+    return slid((_of.*f)());
+}
+
+std::vector<patch> slideview::find(std::vector<patch> (offsetfinder64::*f)()) const{
+    return slid((_of.*f)());
+}
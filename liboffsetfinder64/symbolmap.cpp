@@ -0,0 +1,146 @@
+//
+//  symbolmap.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "symbolmap.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/symbolmap.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <string.h>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+//target of the instruction at words[k], 0 if it doesn't reference anything we can follow
+static loc_t referencedLoc(const uint32_t *words, uint32_t k, loc_t pc){
+    uint32_t w = words[k];
+    if ((w & 0xFC000000) == 0x94000000) {
+        //bl
+        int64_t imm = ((int64_t)(w & 0x3FFFFFF) << 38) >> 36;
+        return pc + imm;
+    }
+    if (!k)
+        return 0;
+    uint32_t prev = words[k-1];
+    if ((prev & 0x9F000000) != 0x90000000 || ((w >> 5) & 0x1f) != (prev & 0x1f))
+        return 0;
+    int64_t imm = (int64_t)((((prev >> 5) & 0x7FFFF) << 2) | ((prev >> 29) & 3));
+    imm = (imm << 43) >> 43;
+    uint64_t page = ((uint64_t)(pc-4) & ~0xfffULL) + (imm << 12);
+    if ((w & 0xFFC00000) == 0x91000000)
+        return (loc_t)(page + ((w >> 10) & 0xfff)); //add x
+    if ((w & 0x3F000000) == 0x39000000)
+        return (loc_t)(page + (((w >> 10) & 0xfff) << (w >> 30))); //ldr/str (unsigned offset), no simd
+    return 0;
+}
+
+symbolmap::symbolmap(offsetfinder64 &reference, offsetfinder64 &stripped) :
+    _uuid(stripped.uuid())
+{
+    retassure(reference.haveSymtab(), "reference kernel has no symtab");
+    offsetporter porter(reference.functionPrints(), stripped.functionPrints());
+    std::unordered_set<std::string> conflicts;
+
+    for (auto &m : porter.matches()) {
+        if (!m.exact)
+            continue; //a wrong fuzzy match would turn into a wrong patch instead of the nosym path
+        if (const char *name = reference.find_sym_name(m.from->start))
+            add(name, m.to->start, conflicts);
+        transferReferences(reference, stripped, m.from->start, m.to->start, m.from->insns, conflicts);
+    }
+    rebuildByAddr();
+}
+
+void symbolmap::add(const std::string &name, loc_t loc, std::unordered_set<std::string> &conflicts){
+    if (conflicts.count(name))
+        return;
+    auto ins = _byName.insert({name,loc});
+    if (!ins.second && ins.first->second != loc) {
+        _byName.erase(ins.first);
+        conflicts.insert(name);
+    }
+}
+
+void symbolmap::transferReferences(offsetfinder64 &reference, offsetfinder64 &stripped, loc_t from, loc_t to, uint32_t insns,
+                                   std::unordered_set<std::string> &conflicts){
+    const uint32_t *fromWords = (const uint32_t *)reference.memoryForLoc(from, 4*(size_t)insns);
+    const uint32_t *toWords = (const uint32_t *)stripped.memoryForLoc(to, 4*(size_t)insns);
+    if (!fromWords || !toWords)
+        return;
+    for (uint32_t k=0; k<insns; k++) {
+        //exact matches have the same instructions, only the targets differ
+        loc_t fromRef = referencedLoc(fromWords, k, from + 4*k);
+        if (!fromRef)
+            continue;
+        const char *name = reference.find_sym_name(fromRef);
+        if (!name)
+            continue;
+        if (loc_t toRef = referencedLoc(toWords, k, to + 4*k))
+            add(name, toRef, conflicts);
+    }
+}
+
+void symbolmap::rebuildByAddr(){
+    _byAddr.clear();
+    _byAddr.reserve(_byName.size());
+    for (auto &s : _byName)
+        _byAddr.insert({s.second,s.first.c_str()}); //first one wins
+}
+
+loc_t symbolmap::find(const char *name) const{
+    auto it = _byName.find(name);
+    return (it != _byName.end()) ? it->second : 0;
+}
+
+const char *symbolmap::nameFor(loc_t loc) const{
+    auto it = _byAddr.find(loc);
+    return (it != _byAddr.end()) ? it->second : NULL;
+}
+
+std::vector<std::pair<const char *,loc_t>> symbolmap::withPrefix(const char *prefix) const{
+    std::vector<std::pair<const char *,loc_t>> ret;
+    size_t prefixlen = strlen(prefix);
+    for (auto &s : _byName) {
+        if (!strncmp(s.first.c_str(), prefix, prefixlen))
+            ret.push_back({s.first.c_str(),s.second});
+    }
+    return ret;
+}
+
+void symbolmap::save(const char *path) const{
+    FILE *f = fopen(path, "w");
+    retassure(f, std::string("failed to open ") + path);
+    fprintf(f, "U %s\n",_uuid.c_str());
+    for (auto &s : _byName)
+        fprintf(f, "S %llx %s\n",(unsigned long long)s.second,s.first.c_str());
+    fclose(f);
+}
+
+void symbolmap::load(const char *path){
+    FILE *f = fopen(path, "r");
+    retassure(f, std::string("failed to open ") + path);
+    _byName.clear();
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len = 0;
+    while ((len = getline(&line, &cap, f)) > 0) {
+        if (line[len-1] == '\n')
+            line[--len] = '\0';
+        if (line[0] == 'U' && line[1] == ' ') {
+            _uuid = line+2;
+        }else if (line[0] == 'S' && line[1] == ' ') {
+            char *name = NULL;
+            unsigned long long loc = strtoull(line+2, &name, 16);
+            if (name && *name == ' ')
+                _byName[name+1] = (loc_t)loc;
+        }
+    }
+    free(line);
+    fclose(f);
+    rebuildByAddr();
+}
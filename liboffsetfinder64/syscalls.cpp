@@ -0,0 +1,160 @@
+//
+//  syscalls.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "syscalls.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/syscalls.hpp>
+#include "all_liboffsetfinder.hpp"
+#include <string.h>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+#define SYSENT_MAX_ENTRIES 0x400
+#define SYSENT_MAX_ARGS 0x10
+#define SYSENT_VALIDATE_ENTRIES 8
+#define MACH_TRAP_TABLE_COUNT 128
+#define MACH_TRAP_TABLE_SEARCH_LIMIT 0x4000
+#define MIG_HOST_PRIV_SUBSYSTEM 400
+
+static const uint32_t sysentStrides[] = {0x18, 0x20};
+static const uint32_t machTrapStrides[] = {0x20, 0x18, 0x28};
+
+syscalltable::syscalltable(offsetfinder64 &of) :
+    _of(of),
+    _sysent(0), _sysentStride(0),
+    _machTraps(0), _machTrapStride(0),
+    _machTrapsParsed(false)
+{
+    parseSysent();
+}
+
+void syscalltable::parseSysent(){
+    //sy_return_type=_SYSCALL_RET_SSIZE_T, sy_narg=3, sy_arg_bytes=12 of read(2). These are the last 8 bytes of a sysent entry
+    constexpr char sig_syscall_3[] = "\x06\x00\x00\x00\x03\x00\x0c\x00";
+    loc_t sys3 = _of.memmem(sig_syscall_3, sizeof(sig_syscall_3)-1);
+    retassure(sys3, "failed to find sysent signature");
+    
+    auto isCode = [&](uint64_t ptr)->bool{
+        const text_t *seg = _of.segmentForLoc((loc_t)ptr);
+        return ptr && seg && seg->isExec;
+    };
+    
+    //record at loc, or NULL if it isn't a plausible sysent entry
+    auto record = [&](loc_t loc, uint32_t stride)->const uint8_t*{
+        const uint8_t *r = (const uint8_t *)_of.rebasedMemoryForLoc(loc, stride);
+        if (!r || !isCode(*(const uint64_t*)r))
+            return NULL;
+        int16_t narg = *(const int16_t*)(r + stride - 4);
+        return (narg >= 0 && narg <= SYSENT_MAX_ARGS) ? r : NULL;
+    };
+    
+    for (uint32_t stride : sysentStrides) {
+        loc_t base = sys3 - (stride - 8) - 3*stride;
+        bool valid = true;
+        for (int i=0; i<SYSENT_VALIDATE_ENTRIES && valid; i++)
+            valid = record(base + i*stride, stride) != NULL;
+        if (!valid)
+            continue;
+        
+        _sysent = base;
+        _sysentStride = stride;
+        break;
+    }
+    retassure(_sysent, "failed to validate sysent");
+    
+    const uint8_t *r = NULL;
+    for (uint32_t i=0; i<SYSENT_MAX_ENTRIES && (r = record(_sysent + i*_sysentStride, _sysentStride)); i++) {
+        _syscalls.push_back({i,(loc_t)*(const uint64_t*)r,(uint32_t)*(const int16_t*)(r + _sysentStride - 4)});
+    }
+}
+
+void syscalltable::parseMachTraps(){
+    //mach_trap_table lives right before host_priv_subsystem in const data
+    loc_t host_priv_subsystem = _of.mig().subsystem(MIG_HOST_PRIV_SUBSYSTEM).location;
+    const text_t *seg = _of.segmentForLoc(host_priv_subsystem);
+    assure(seg);
+    
+    for (uint32_t stride : machTrapStrides) {
+        size_t words = stride/sizeof(uint64_t);
+        
+        for (loc_t cur = host_priv_subsystem - 8; host_priv_subsystem - cur <= MACH_TRAP_TABLE_SEARCH_LIMIT*8; cur -= 8) {
+            if (cur < seg->base + stride || cur + 5*stride > seg->base + seg->size)
+                break;
+            
+            //a run of kern_invalid entries (pointer followed by zeros), preceded by a {0,1,0} entry
+            const uint64_t *prev = (const uint64_t *)_of.rebasedMemoryForLoc(cur - stride, 6*stride);
+            const uint64_t *obj = prev + words;
+            bool match = (prev[0] == 0 && prev[1] == 1 && prev[2] == 0);
+            for (size_t w=1; w+1<words && match; w++)
+                match = !obj[w];
+            for (int k=1; k<5 && match; k++)
+                match = !memcmp(obj, (const uint8_t*)obj + k*stride, stride);
+            if (!match)
+                continue;
+            
+            //cur is 0x10 into trap 0, mach_trap_function of trap i is at cur - 8 + i*stride
+            _machTraps = cur - 0x10;
+            _machTrapStride = stride;
+            break;
+        }
+        if (_machTraps)
+            break;
+    }
+    retassure(_machTraps, "failed to find mach_trap_table");
+    
+    for (uint32_t i=0; i<MACH_TRAP_TABLE_COUNT; i++) {
+        const uint64_t *r = (const uint64_t *)_of.rebasedMemoryForLoc(_machTraps + i*_machTrapStride, 16);
+        entry e = {i,0,0};
+        if (r) {
+            const text_t *hseg = _of.segmentForLoc((loc_t)r[1]);
+            if (hseg && hseg->isExec) {
+                e.handler = (loc_t)r[1];
+                e.argc = (uint32_t)(r[0] & 0xff); //mach_trap_arg_count precedes mach_trap_function
+            }
+        }
+        _machtraps.push_back(e);
+    }
+}
+
+const syscalltable::entry &syscalltable::syscall(uint32_t num) const{
+    retassure(num < _syscalls.size(), "syscall " + std::to_string(num) + " out of range");
+    return _syscalls[num];
+}
+
+void syscalltable::ensureMachTraps(){
+    if (_machTrapsParsed.load(std::memory_order_acquire))
+        return;
+    std::unique_lock<std::mutex> l(_machTrapsLock);
+    if (!_machTrapsParsed.load(std::memory_order_relaxed)) {
+        parseMachTraps();
+        _machTrapsParsed.store(true, std::memory_order_release);
+    }
+}
+
+loc_t syscalltable::machTrapLocation(){
+    ensureMachTraps();
+    return _machTraps;
+}
+
+uint32_t syscalltable::machTrapStride(){
+    ensureMachTraps();
+    return _machTrapStride;
+}
+
+const std::vector<syscalltable::entry> &syscalltable::machTraps(){
+    ensureMachTraps();
+    return _machtraps;
+}
+
+const syscalltable::entry &syscalltable::machTrap(uint32_t num){
+    const std::vector<entry> &traps = machTraps();
+    retassure(num < traps.size() && traps[num].handler, "mach trap " + std::to_string(num) + " not found");
+    return traps[num];
+}
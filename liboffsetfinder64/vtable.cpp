@@ -0,0 +1,219 @@
+//
+//  vtable.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#define LOCAL_FILENAME "vtable.cpp"
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/vtable.hpp>
+#include "all_liboffsetfinder.hpp"
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+#define VTABLE_MAX_ENTRIES 0x400
+#define VTABLE_HEADER_SIZE (2*sizeof(uint64_t)) //offset-to-top and rtti, both 0 in the kernel
+#define VTABLE_MIN_ENTRIES_STRIPPED 4
+
+vtablecache::vtablecache(offsetfinder64 &of) :
+    _of(of)
+{
+    if (_of.haveSymtab()) { //synthesized symbols only know some vtables
+        indexSymbols();
+    }else{
+        indexStripped();
+        nameStripped();
+    }
+    
+    for (auto &it : _byBase) {
+        const vtable *vt = it.second.get();
+        for (auto &e : vt->entries)
+            _byImpl[(uint64_t)e.target].push_back({vt,e.index});
+    }
+}
+
+std::string vtablecache::vtableSymbol(const std::string &classname){
+    return "__ZTV" + std::to_string(classname.size()) + classname;
+}
+
+std::shared_ptr<vtable> vtablecache::decode(loc_t base, const std::string &classname){
+    auto it = _byBase.find((uint64_t)base);
+    if (it != _byBase.end()) {
+        if (it->second->classname.empty())
+            it->second->classname = classname;
+        return it->second;
+    }
+    
+    std::shared_ptr<vtable> vt(new vtable);
+    vt->classname = classname;
+    vt->base = base;
+    
+    for (uint32_t i=0; i<VTABLE_MAX_ENTRIES; i++) {
+        const uint64_t *slot = (const uint64_t *)_of.rebasedMemoryForLoc(base + i*sizeof(uint64_t), sizeof(uint64_t));
+        if (!slot)
+            break;
+        loc_t target = (loc_t)*slot;
+        const text_t *seg = _of.segmentForLoc(target);
+        if (!seg || !seg->isExec)
+            break; //end of vtable
+        vt->entries.push_back({i,target,_of.find_sym_name(target)});
+    }
+    
+    _byBase[(uint64_t)base] = vt;
+    return vt;
+}
+
+const vtable &vtablecache::forClass(const std::string &classname) const{
+    auto it = _byClass.find(classname);
+    retassure(it != _byClass.end(), "no vtable for class " + classname);
+    return *it->second;
+}
+
+const vtable &vtablecache::at(loc_t base) const{
+    auto it = _byBase.find((uint64_t)base);
+    retassure(it != _byBase.end(), "no vtable at base");
+    return *it->second;
+}
+
+void vtablecache::indexStripped(){
+    //a vtable is two zero words followed by a run of pointers into code
+    for (auto &seg : _of.segments()) {
+        if (seg.isExec || !seg.size)
+            continue;
+        const uint64_t *words = (const uint64_t *)_of.rebasedMemoryForLoc(seg.base, seg.size);
+        if (!words)
+            continue;
+        size_t cnt = seg.size / sizeof(uint64_t);
+        for (size_t i=0; i+2+VTABLE_MIN_ENTRIES_STRIPPED <= cnt; i++) {
+            if (words[i] || words[i+1])
+                continue;
+            size_t k = 0;
+            for (; k<VTABLE_MIN_ENTRIES_STRIPPED; k++) {
+                const text_t *tseg = _of.segmentForLoc((loc_t)words[i+2+k]);
+                if (!tseg || !tseg->isExec)
+                    break;
+            }
+            if (k < VTABLE_MIN_ENTRIES_STRIPPED)
+                continue;
+            auto vt = decode(seg.base + (i+2)*sizeof(uint64_t), "");
+            i += 1 + vt->entries.size();
+        }
+    }
+}
+
+static uint64_t adrpPage(uint64_t pc, uint32_t w){
+    int64_t imm = (int64_t)((((w >> 5) & 0x7FFFF) << 2) | ((w >> 29) & 3));
+    imm = (imm << 43) >> 43; //sign extend 21 bits
+    return (pc & ~0xfffULL) + (imm << 12);
+}
+
+//getMetaClass() of every OSObject subclass is "adrp x0, gMetaClass@PAGE ; add x0, x0, gMetaClass@PAGEOFF ; ret"
+static uint64_t metaClassReturnedBy(offsetfinder64 &of, loc_t func){
+    const uint32_t *w = (const uint32_t *)of.memoryForLoc(func, 3*sizeof(uint32_t));
+    if (!w
+        || (w[0] & 0x9F00001F) != 0x90000000    //adrp x0
+        || (w[1] & 0xFFC003FF) != 0x91000000    //add x0, x0, #imm
+        || w[2] != 0xD65F03C0)                  //ret
+        return 0;
+    return adrpPage((uint64_t)func, w[0]) + ((w[1] >> 10) & 0xfff);
+}
+
+void vtablecache::nameStripped(){
+    //metaclass instance -> vtables whose getMetaClass() returns it
+    std::unordered_map<uint64_t, std::vector<vtable*>> byMeta;
+    for (auto &it : _byBase) {
+        for (auto &e : it.second->entries) {
+            if (uint64_t meta = metaClassReturnedBy(_of, e.target)) {
+                byMeta[meta].push_back(it.second.get());
+                break;
+            }
+        }
+    }
+    if (byMeta.empty())
+        return;
+
+    /*
+     metaclass instances are constructed in static initializers by
+        OSMetaClass::OSMetaClass(this = &gMetaClass, className, superclass, size)
+     so a call with x0 = a metaclass instance and x1 = a C string names its class.
+     Only adrp+add pairs are tracked, everything else is assumed not to touch x0/x1.
+     */
+    const cstringindex &strs = _of.cstrings();
+    std::unordered_map<uint64_t, const char *> names;
+    std::unordered_map<uint64_t, bool> conflicts;
+    for (auto &seg : _of.segments()) {
+        if (!seg.isExec)
+            continue;
+        const uint32_t *words = (const uint32_t *)seg.map;
+        size_t n = seg.size / 4;
+        uint64_t page[32] = {};
+        uint64_t x0 = 0, x1 = 0;
+        for (size_t k=0; k<n; k++) {
+            uint32_t w = words[k];
+            uint64_t pc = (uint64_t)seg.base + 4*k;
+            if ((w & 0x9F000000) == 0x90000000) { //adrp
+                page[w & 0x1f] = adrpPage(pc, w);
+                if ((w & 0x1f) == 0) x0 = 0;
+                if ((w & 0x1f) == 1) x1 = 0;
+            }else if ((w & 0xFFC00000) == 0x91000000) { //add x, immediate
+                uint32_t rd = w & 0x1f, rn = (w >> 5) & 0x1f;
+                uint64_t v = (rd == rn && page[rn]) ? page[rn] + ((w >> 10) & 0xfff) : 0;
+                page[rd] = 0;
+                if (rd == 0) x0 = v;
+                if (rd == 1) x1 = v;
+            }else if ((w & 0xFC000000) == 0x94000000 || w == 0xD65F03C0) { //bl, ret
+                if (w != 0xD65F03C0 && x0 && x1 && byMeta.count(x0)) {
+                    if (const char *name = strs.stringAt((loc_t)x1)) {
+                        auto ins = names.insert({x0,name});
+                        if (!ins.second && strcmp(ins.first->second, name))
+                            conflicts[x0] = true;
+                    }
+                }
+                memset(page, 0, sizeof(page));
+                x0 = x1 = 0;
+            }
+        }
+    }
+
+    for (auto &it : names) {
+        auto &vts = byMeta[it.first];
+        if (conflicts.count(it.first) || vts.size() != 1)
+            continue;
+        vtable *vt = vts.front();
+        vt->classname = it.second;
+        _byClass.insert({vt->classname,_byBase[(uint64_t)vt->base]});
+    }
+}
+
+void vtablecache::indexSymbols(){
+    for (auto &sym : _of.find_syms_with_prefix("__ZTV")) {
+        //__ZTV<len><classname>
+        char *cls = NULL;
+        long len = strtol(sym.first+5, &cls, 10);
+        if (len <= 0 || (long)strlen(cls) != len || !sym.second)
+            continue; //nested names, templates etc.
+        auto vt = decode(sym.second + VTABLE_HEADER_SIZE, cls);
+        _byClass.insert({cls,vt});
+    }
+}
+
+const std::vector<std::pair<const vtable*,uint32_t>> &vtablecache::slotsOf(loc_t impl) const{
+    static const std::vector<std::pair<const vtable*,uint32_t>> none;
+    auto it = _byImpl.find((uint64_t)impl);
+    return (it != _byImpl.end()) ? it->second : none;
+}
+
+int32_t vtablecache::slotOf(const std::string &classname, loc_t impl) const{
+    auto it = _byImpl.find((uint64_t)impl);
+    if (it == _byImpl.end())
+        return -1;
+    for (auto &s : it->second) {
+        if (s.first->classname == classname)
+            return s.second;
+    }
+    return -1;
+}
@@ -0,0 +1,100 @@
+//
+//  concurrency.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include "fakekernel.hpp"
+#include <atomic>
+#include <thread>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+#define THREADS 8
+#define ROUNDS 200
+
+/*
+ all threads hit the lazily built tables of a fresh finder at the same time.
+ Every thread has to get the same table objects with the same content.
+ */
+
+struct seen{
+    const void *tables[7];
+    size_t calls;
+    size_t functions;
+    loc_t str;
+    loc_t nextBl;
+};
+
+static void lookup(offsetfinder64 &of, seen &s){
+    s.tables[0] = &of.insnIndex();
+    s.tables[1] = &of.callGraph();
+    s.tables[2] = &of.jumpStubs();
+    s.tables[3] = &of.cstrings();
+    s.tables[4] = &of.pointers();
+    s.tables[5] = &of.functionPrints();
+    s.tables[6] = &of.vtables();
+    s.calls = of.callGraph().size();
+    s.functions = of.callGraph().functions().size();
+    s.str = of.cstrings().find("hello", 5);
+    s.nextBl = of.insnIndex().nextOf(insn::bl, (loc_t)FAKE_TEXT);
+}
+
+int main(){
+    std::vector<uint32_t> code = {
+        0xA9BF7BFD,     //0:  stp x29, x30, [sp, #-0x10]!
+        fake_bl(1, 6),  //1:  bl 6
+        fake_bl(2, 10), //2:  bl 10
+        0xB0000020,     //3:  adrp x0, FAKE_DATA+0x1000
+        0x91000000,     //4:  add x0, x0, #0
+        0xD65F03C0,     //5:  ret
+        0xA9BF7BFD,     //6:  stp x29, x30, [sp, #-0x10]!
+        fake_bl(7, 10), //7:  bl 10
+        0xA8C17BFD,     //8:  ldp x29, x30, [sp], #0x10
+        0xD65F03C0,     //9:  ret
+        0xA9BF7BFD,     //10: stp x29, x30, [sp, #-0x10]!
+        0xD65F03C0,     //11: ret
+    };
+    fakekernel k(code, {0,0}, {'h','e','l','l','o','\0'});
+
+    seen expected = {};
+    {
+        offsetfinder64 of(k.buf.data(), k.buf.size(), 0);
+        lookup(of, expected);
+        CHECK(expected.calls == 3);
+        CHECK(expected.str == (loc_t)(FAKE_DATA + 0x1000));
+        CHECK(expected.nextBl == (loc_t)(FAKE_TEXT + 4));
+    }
+
+    for (int r=0; r<ROUNDS; r++) {
+        offsetfinder64 of(k.buf.data(), k.buf.size(), 0);
+        std::atomic<int> ready(0);
+        seen results[THREADS] = {};
+        std::vector<std::thread> threads;
+        for (int t=0; t<THREADS; t++) {
+            threads.push_back(std::thread([&,t]{
+                ready++;
+                while (ready.load() < THREADS)
+                    ;
+                lookup(of, results[t]);
+            }));
+        }
+        for (auto &t : threads)
+            t.join();
+
+        for (int t=0; t<THREADS; t++) {
+            for (int i=0; i<7; i++)
+                CHECK(results[t].tables[i] == results[0].tables[i]);
+            CHECK(results[t].calls == expected.calls);
+            CHECK(results[t].functions == expected.functions);
+            CHECK(results[t].str == expected.str);
+            CHECK(results[t].nextBl == expected.nextBl);
+        }
+    }
+    printf("concurrency ok\n");
+    return 0;
+}
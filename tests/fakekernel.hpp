@@ -0,0 +1,90 @@
+//
+//  fakekernel.hpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#ifndef fakekernel_hpp
+#define fakekernel_hpp
+
+#include <mach-o/loader.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+
+#define FAKE_TEXT 0xfffffff007004000ULL
+#define FAKE_DATA 0xfffffff007008000ULL
+
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); exit(1); } } while (0)
+
+/*
+ minimal kernel image for tests:
+    __TEXT_EXEC at FAKE_TEXT with code,
+    __DATA      at FAKE_DATA with data,
+    __TEXT      right after __DATA with a __cstring section holding strings,
+ and an LC_UNIXTHREAD pointing at the start of code.
+ */
+struct fakekernel{
+    std::vector<uint8_t> buf;
+
+    fakekernel(const std::vector<uint32_t> &code, const std::vector<uint64_t> &data, const std::vector<char> &strings = {}){
+        const size_t seg = 0x1000;
+        buf.resize(4*seg);
+        struct mach_header_64 *mh = (struct mach_header_64 *)buf.data();
+        mh->magic = MH_MAGIC_64;
+        mh->filetype = MH_EXECUTE;
+        uint8_t *p = (uint8_t *)(mh + 1);
+
+        auto segment = [&](const char *name, uint64_t vmaddr, uint64_t fileoff, int prot, const char *sectname, uint64_t sectsize){
+            struct segment_command_64 *s = (struct segment_command_64 *)p;
+            s->cmd = LC_SEGMENT_64;
+            s->cmdsize = sizeof(*s) + (sectname ? sizeof(struct section_64) : 0);
+            strncpy(s->segname, name, sizeof(s->segname));
+            s->vmaddr = vmaddr;
+            s->vmsize = seg;
+            s->fileoff = fileoff;
+            s->filesize = seg;
+            s->maxprot = s->initprot = prot;
+            if (sectname) {
+                struct section_64 *sect = (struct section_64 *)(s + 1);
+                strncpy(sect->sectname, sectname, sizeof(sect->sectname));
+                strncpy(sect->segname, name, sizeof(sect->segname));
+                sect->addr = vmaddr;
+                sect->size = sectsize;
+                sect->offset = (uint32_t)fileoff;
+                s->nsects = 1;
+            }
+            p += s->cmdsize;
+            mh->ncmds++;
+        };
+        segment("__TEXT_EXEC", FAKE_TEXT, seg, 5, NULL, 0);
+        segment("__DATA", FAKE_DATA, 2*seg, 3, NULL, 0);
+        segment("__TEXT", FAKE_DATA + seg, 3*seg, 1, strings.size() ? "__cstring" : NULL, strings.size());
+
+        struct load_command *lc = (struct load_command *)p;
+        lc->cmd = LC_UNIXTHREAD;
+        lc->cmdsize = 8+8+34*8+8;
+        uint32_t *flavor = (uint32_t *)(lc + 1);
+        flavor[0] = 6; //ARM_THREAD_STATE64
+        ((uint64_t *)(flavor + 2))[32] = FAKE_TEXT; //pc
+        p += lc->cmdsize;
+        mh->ncmds++;
+        mh->sizeofcmds = (uint32_t)(p - (uint8_t *)(mh + 1));
+
+        memcpy(&buf[seg], code.data(), code.size()*sizeof(uint32_t));
+        memcpy(&buf[2*seg], data.data(), data.size()*sizeof(uint64_t));
+        if (strings.size())
+            memcpy(&buf[3*seg], strings.data(), strings.size());
+    }
+};
+
+//bl from word index i to word index j
+static inline uint32_t fake_bl(int i, int j){
+    return 0x94000000 | ((uint32_t)(j-i) & 0x3FFFFFF);
+}
+
+#endif /* fakekernel_hpp */
@@ -0,0 +1,53 @@
+//
+//  pattern.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/pattern.hpp>
+#include "fakekernel.hpp"
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+static bool compiles(const char *src){
+    try {
+        pattern p(src);
+        return true;
+    } catch (tihmstar::exception &e) {
+        return false;
+    }
+}
+
+static bool matches(const char *src, uint32_t w){
+    patternmatch m;
+    return pattern(src).match(&w, 1, m);
+}
+
+int main(){
+    //unsigned offset
+    CHECK(matches("ldr x0, [x1, #8]", 0xF9400420));
+    CHECK(matches("ldr x0, [x1]", 0xF9400020));
+    CHECK(matches("ldr w0, [sp, #4]", 0xB94007E0));
+    CHECK(!matches("ldr x0, [x1, #8]", 0xF8408C20)); //ldr x0, [x1, #8]!
+
+    //pre- and post-index have other encodings
+    CHECK(!compiles("ldr x0, [x1, #8]!"));
+    CHECK(!compiles("ldr x0, [x1], #8"));
+    CHECK(!compiles("ldr x0, x1, #8"));
+    CHECK(!compiles("add x0, [x1, #8]"));
+    CHECK(!compiles("ldr x0, [w1]"));
+
+    //register 31
+    CHECK(matches("add x0, sp, #0x10", 0x910043E0));
+    CHECK(!compiles("add x0, xzr, #0x10"));
+    CHECK(matches("mov x0, xzr", 0xAA1F03E0));
+    CHECK(!compiles("mov x0, sp"));
+    CHECK(!compiles("ldr x0, [xzr]"));
+
+    printf("pattern ok\n");
+    return 0;
+}
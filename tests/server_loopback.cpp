@@ -0,0 +1,99 @@
+//
+//  server_loopback.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include <liboffsetfinder64/server.hpp>
+#include "fakekernel.hpp"
+#include <thread>
+#include <string>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+/*
+ runs an offsetserver on a unix socket in /tmp and talks to it over the client side.
+ Every request, including failing ones, has to get exactly one JSON reply.
+ */
+
+static bool contains(const std::string &str, const std::string &sub){
+    return str.find(sub) != std::string::npos;
+}
+
+int main(){
+    std::string dir = "/tmp/offsetfinder64-test-" + std::to_string(getpid());
+    std::string sock = dir + ".sock";
+    std::string kernelpath = dir + ".kernel";
+
+    fakekernel k({0xA9BF7BFD, 0xD65F03C0}, {0,0});
+    FILE *f = fopen(kernelpath.c_str(), "wb");
+    CHECK(f);
+    CHECK(fwrite(k.buf.data(), 1, k.buf.size(), f) == k.buf.size());
+    fclose(f);
+
+    //never replace something that isn't a socket
+    bool refused = false;
+    try {
+        offsetserver server(kernelpath, 1);
+    } catch (tihmstar::exception &e) {
+        refused = true;
+    }
+    CHECK(refused);
+    CHECK(!access(kernelpath.c_str(), F_OK));
+
+    {
+        offsetserver server(sock, 2);
+        std::thread t([&server]{server.serve();});
+        struct stat st = {};
+        CHECK(!stat(sock.c_str(), &st) && (st.st_mode & 0777) == 0600);
+
+        //idle connections must not starve the pool
+        int idle[2];
+        for (int &fd : idle) {
+            struct sockaddr_un addr = {};
+            addr.sun_family = AF_UNIX;
+            strncpy(addr.sun_path, sock.c_str(), sizeof(addr.sun_path)-1);
+            CHECK((fd = socket(AF_UNIX, SOCK_STREAM, 0)) != -1);
+            CHECK(!connect(fd, (struct sockaddr *)&addr, sizeof(addr)));
+        }
+
+        std::string r = offsetserver::request(sock, "stats");
+        CHECK(contains(r, "\"requests\":0"));
+
+        r = offsetserver::request(sock, "bogus");
+        CHECK(contains(r, "\"error\":\"unknown command bogus\""));
+
+        r = offsetserver::request(sock, "find " + dir + ".missing find_sbops");
+        CHECK(contains(r, "\"error\":\"failed to stat"));
+
+        r = offsetserver::request(sock, "find " + kernelpath + " no_such_finder 0x1000");
+        CHECK(contains(r, "\"cached\":false"));
+        CHECK(contains(r, "\"slide\":\"0x1000\""));
+        CHECK(contains(r, "\"errors\":{\"no_such_finder\":\"unknown finder\"}"));
+
+        r = offsetserver::request(sock, "find " + kernelpath + " no_such_finder");
+        CHECK(contains(r, "\"cached\":true"));
+
+        r = offsetserver::request(sock, "stats");
+        CHECK(contains(r, "\"requests\":4"));
+        CHECK(contains(r, "\"failed\":4"));
+        CHECK(contains(r, "\"cache_hits\":1"));
+
+        for (int fd : idle)
+            close(fd);
+        r = offsetserver::request(sock, "shutdown");
+        CHECK(contains(r, "\"shutdown\":true"));
+        t.join();
+    }
+    unlink(kernelpath.c_str());
+    printf("server loopback ok\n");
+    return 0;
+}
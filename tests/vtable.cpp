@@ -0,0 +1,55 @@
+//
+//  vtable.cpp
+//  liboffsetfinder64
+//
+//  Created by tihmstar on 18.10.26.
+//  Copyright © 2026 tihmstar. All rights reserved.
+//
+
+#include <liboffsetfinder64/liboffsetfinder64.hpp>
+#include "fakekernel.hpp"
+
+using namespace tihmstar;
+using namespace patchfinder64;
+
+/*
+ stripped kernel with one vtable, which is named through its getMetaClass() entry
+ and the OSMetaClass constructor call of the static initializer.
+ */
+int main(){
+    std::vector<uint32_t> code = {
+        0xD65F03C0,     //0:  ret                       (other virtual methods)
+        0x90000020,     //1:  adrp x0, FAKE_DATA        getMetaClass()
+        0x91040000,     //2:  add x0, x0, #0x100
+        0xD65F03C0,     //3:  ret
+        0x90000020,     //4:  adrp x0, FAKE_DATA        static initializer
+        0x91040000,     //5:  add x0, x0, #0x100
+        0xB0000021,     //6:  adrp x1, FAKE_DATA+0x1000
+        0x91000021,     //7:  add x1, x1, #0
+        fake_bl(8, 0),  //8:  bl OSMetaClass::OSMetaClass
+        0xD65F03C0,     //9:  ret
+    };
+    std::vector<uint64_t> data = {
+        0, 0,
+        FAKE_TEXT, FAKE_TEXT, FAKE_TEXT + 4, FAKE_TEXT, //vtable at FAKE_DATA+0x10
+    };
+    const char name[] = "IOUserClient";
+    fakekernel k(code, data, std::vector<char>(name, name+sizeof(name)));
+
+    offsetfinder64 of(k.buf.data(), k.buf.size(), 0);
+    const vtable &vt = of.vtables().forClass("IOUserClient");
+    CHECK(vt.base == (loc_t)(FAKE_DATA + 0x10));
+    CHECK(vt.entries.size() == 4);
+    CHECK(of.vtables().slotOf("IOUserClient", (loc_t)(FAKE_TEXT + 4)) == 2);
+
+    bool threw = false;
+    try {
+        of.vtables().forClass("IOService");
+    } catch (tihmstar::exception &e) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    printf("vtable ok\n");
+    return 0;
+}